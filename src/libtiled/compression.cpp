@@ -34,9 +34,15 @@
 #include <zlib.h>
 #endif
 
+#ifdef TILED_ZSTD_SUPPORT
+#include <zstd.h>
+#endif
+
 #include <QByteArray>
 #include <QDebug>
 
+#include <climits>
+
 #include "qtcompat_p.h"
 
 #ifdef Z_PREFIX
@@ -65,11 +71,123 @@ static void logZlibError(int error)
     }
 }
 
-QByteArray Tiled::decompress(const QByteArray &data, int expectedSize)
+#ifdef TILED_ZSTD_SUPPORT
+static void logZstdError(size_t error)
+{
+    qDebug() << "Error while (de)compressing Zstandard data:"
+             << ZSTD_getErrorName(error);
+}
+
+static QByteArray decompressZstd(const QByteArray &data, int expectedSize)
+{
+    // Decompress in one go when the frame tells the size of the content
+    const unsigned long long contentSize = ZSTD_getFrameContentSize(data.constData(),
+                                                                    data.size());
+
+    if (contentSize != ZSTD_CONTENTSIZE_UNKNOWN &&
+            contentSize != ZSTD_CONTENTSIZE_ERROR &&
+            contentSize <= static_cast<unsigned long long>(INT_MAX)) {
+        QByteArray out;
+        out.resize(static_cast<int>(contentSize));
+
+        const size_t ret = ZSTD_decompress(out.data(), out.size(),
+                                           data.constData(), data.size());
+        if (ZSTD_isError(ret)) {
+            logZstdError(ret);
+            return QByteArray();
+        }
+
+        out.resize(static_cast<int>(ret));
+        return out;
+    }
+
+    ZSTD_DStream *stream = ZSTD_createDStream();
+    ZSTD_initDStream(stream);
+
+    QByteArray out;
+    out.resize(qMax(expectedSize, 1024));
+
+    ZSTD_inBuffer inBuffer = { data.constData(), static_cast<size_t>(data.size()), 0 };
+    ZSTD_outBuffer outBuffer = { out.data(), static_cast<size_t>(out.size()), 0 };
+
+    size_t ret;
+    do {
+        if (outBuffer.pos == outBuffer.size) {
+            // More output space needed
+            out.resize(out.size() * 2);
+            outBuffer.dst = out.data();
+            outBuffer.size = out.size();
+        }
+
+        ret = ZSTD_decompressStream(stream, &outBuffer, &inBuffer);
+        if (ZSTD_isError(ret)) {
+            logZstdError(ret);
+            ZSTD_freeDStream(stream);
+            return QByteArray();
+        }
+    } while (ret != 0 && (inBuffer.pos < inBuffer.size || outBuffer.pos == outBuffer.size));
+
+    ZSTD_freeDStream(stream);
+
+    if (ret != 0 || inBuffer.pos != inBuffer.size) {
+        qDebug() << "Incorrect Zstandard compressed data!";
+        return QByteArray();
+    }
+
+    out.resize(static_cast<int>(outBuffer.pos));
+    return out;
+}
+
+static QByteArray compressZstd(const QByteArray &data, int compressionLevel)
+{
+    // Level 0 selects the default compression level of Zstandard
+    if (compressionLevel != -1)
+        compressionLevel = qBound(1, compressionLevel, ZSTD_maxCLevel());
+    else
+        compressionLevel = 0;
+
+    QByteArray out;
+    out.resize(static_cast<int>(ZSTD_compressBound(data.size())));
+
+    const size_t ret = ZSTD_compress(out.data(), out.size(),
+                                     data.constData(), data.size(),
+                                     compressionLevel);
+    if (ZSTD_isError(ret)) {
+        logZstdError(ret);
+        return QByteArray();
+    }
+
+    out.resize(static_cast<int>(ret));
+    return out;
+}
+#endif // TILED_ZSTD_SUPPORT
+
+bool Tiled::compressionSupported(CompressionMethod method)
+{
+#ifdef TILED_ZSTD_SUPPORT
+    Q_UNUSED(method)
+    return true;
+#else
+    return method != Zstandard;
+#endif
+}
+
+QByteArray Tiled::decompress(const QByteArray &data,
+                             int expectedSize,
+                             CompressionMethod method)
 {
     if (data.isEmpty())
         return QByteArray();
 
+    if (method == Zstandard) {
+#ifdef TILED_ZSTD_SUPPORT
+        return decompressZstd(data, expectedSize);
+#else
+        qDebug() << "Zstandard compression is not supported by this build!";
+        return QByteArray();
+#endif
+    }
+
     QByteArray out;
     out.resize(expectedSize);
     z_stream strm;
@@ -126,11 +244,27 @@ QByteArray Tiled::decompress(const QByteArray &data, int expectedSize)
     return out;
 }
 
-QByteArray Tiled::compress(const QByteArray &data, CompressionMethod method)
+QByteArray Tiled::compress(const QByteArray &data,
+                           CompressionMethod method,
+                           int compressionLevel)
 {
     if (data.isEmpty())
         return QByteArray();
 
+    if (method == Zstandard) {
+#ifdef TILED_ZSTD_SUPPORT
+        return compressZstd(data, compressionLevel);
+#else
+        qDebug() << "Zstandard compression is not supported by this build!";
+        return QByteArray();
+#endif
+    }
+
+    if (compressionLevel != -1)
+        compressionLevel = qBound(0, compressionLevel, 9);
+    else
+        compressionLevel = Z_DEFAULT_COMPRESSION;
+
     QByteArray out;
     out.resize(1024);
     int err;
@@ -145,7 +279,7 @@ QByteArray Tiled::compress(const QByteArray &data, CompressionMethod method)
 
     const int windowBits = (method == Gzip) ? 15 + 16 : 15;
 
-    err = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits,
+    err = deflateInit2(&strm, compressionLevel, Z_DEFLATED, windowBits,
                        8, Z_DEFAULT_STRATEGY);
     if (err != Z_OK) {
         logZlibError(err);
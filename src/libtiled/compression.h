@@ -36,34 +36,50 @@ namespace Tiled {
 
 enum CompressionMethod {
     Gzip,
-    Zlib
+    Zlib,
+    Zstandard
 };
 
 /**
- * Decompresses either zlib or gzip compressed memory. Returns a null
- * QByteArray if decompressing failed.
+ * Returns whether the given compression \a method is supported. Zstandard
+ * support depends on whether libtiled was built against libzstd.
+ */
+bool TILEDSHARED_EXPORT compressionSupported(CompressionMethod method);
+
+/**
+ * Decompresses either zlib, gzip or Zstandard compressed memory. Returns a
+ * null QByteArray if decompressing failed.
  *
  * Needed because qUncompress does not support gzip compressed data. Also,
  * this method does not need the expected size to be prepended to the data,
  * but it can be passed as optional parameter.
  *
+ * Zlib and gzip compressed data are detected automatically, so \a method
+ * only needs to be specified for Zstandard compressed data.
+ *
  * @param data         the compressed data
  * @param expectedSize the expected size of the uncompressed data in bytes
+ * @param method       the compression method used for the data
  * @return the uncompressed data, or a null QByteArray if decompressing failed
  */
 QByteArray TILEDSHARED_EXPORT decompress(const QByteArray &data,
-                                         int expectedSize = 1024);
+                                         int expectedSize = 1024,
+                                         CompressionMethod method = Zlib);
 
 /**
- * Compresses the give data in either gzip or zlib format. Returns a null
- * QByteArray if compression failed.
+ * Compresses the give data in either gzip, zlib or Zstandard format.
+ * Returns a null QByteArray if compression failed.
  *
  * Needed because qCompress does not support gzip compression.
  *
- * @param data the uncompressed data
+ * @param data             the uncompressed data
+ * @param method           the compression method to use
+ * @param compressionLevel the compression level, or -1 for the default
+ *                         level of the compression method
  * @return the compressed data, or a null QByteArray if compression failed
  */
 QByteArray TILEDSHARED_EXPORT compress(const QByteArray &data,
-                                       CompressionMethod method = Zlib);
+                                       CompressionMethod method = Zlib,
+                                       int compressionLevel = -1);
 
 } // namespace Tiled
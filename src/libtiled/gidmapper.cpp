@@ -33,6 +33,11 @@
 #include "tiled.h"
 #include "tileset.h"
 
+#include <QVarLengthArray>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+
 using namespace Tiled;
 
 // Bits on the far end of the 32-bit global tile ID are used for tile flags
@@ -42,6 +47,25 @@ const unsigned FlippedAntiDiagonallyFlag = 0x20000000;
 
 const unsigned RotatedHexagonal120Flag   = 0x10000000;
 
+/**
+ * Returns the GID flags matching the visual flags of a packed cell, which are
+ * stored as FlippedHorizontally, FlippedVertically, FlippedAntiDiagonally and
+ * RotatedHexagonal120 from the lowest bit up.
+ */
+static unsigned gidFlagsForPackedFlags(unsigned flags)
+{
+    unsigned gidFlags = 0;
+    if (flags & 0x01)
+        gidFlags |= FlippedHorizontallyFlag;
+    if (flags & 0x02)
+        gidFlags |= FlippedVerticallyFlag;
+    if (flags & 0x04)
+        gidFlags |= FlippedAntiDiagonallyFlag;
+    if (flags & 0x08)
+        gidFlags |= RotatedHexagonal120Flag;
+    return gidFlags;
+}
+
 /**
  * Default constructor. Use \l insert to initialize the gid mapper
  * incrementally.
@@ -118,18 +142,12 @@ unsigned GidMapper::cellToGid(const Cell &cell) const
     if (cell.isEmpty())
         return 0;
 
-    const Tileset *tileset = cell.tileset();
-
     // Find the first GID for the tileset
-    QMap<unsigned, SharedTileset>::const_iterator i = mFirstGidToTileset.begin();
-    QMap<unsigned, SharedTileset>::const_iterator i_end = mFirstGidToTileset.end();
-    while (i != i_end && i.value() != tileset)
-        ++i;
-
-    if (i == i_end) // tileset not found
+    const auto it = mTilesetToFirstGid.constFind(cell.tileset());
+    if (it == mTilesetToFirstGid.constEnd()) // tileset not found
         return 0;
 
-    unsigned gid = i.key() + cell.tileId();
+    unsigned gid = it.value() + cell.tileId();
     if (cell.flippedHorizontally())
         gid |= FlippedHorizontallyFlag;
     if (cell.flippedVertically())
@@ -142,14 +160,85 @@ unsigned GidMapper::cellToGid(const Cell &cell) const
     return gid;
 }
 
+/**
+ * Returns the global tile IDs for the cells of the given \a tileLayer within
+ * \a bounds, row by row.
+ *
+ * This is equivalent to calling cellToGid() for each cell, but converts the
+ * layer one chunk at a time, looking up each used tileset only once per chunk.
+ */
+QVector<unsigned> GidMapper::cellsToGids(const TileLayer &tileLayer,
+                                         QRect bounds) const
+{
+    QVector<unsigned> gids(bounds.width() * bounds.height(), 0);
+    if (gids.isEmpty())
+        return gids;
+
+    unsigned chunkGids[CHUNK_SIZE * CHUNK_SIZE];
+
+    const int startX = bounds.left() - (bounds.left() & CHUNK_MASK);
+    const int startY = bounds.top() - (bounds.top() & CHUNK_MASK);
+
+    for (int chunkY = startY; chunkY <= bounds.bottom(); chunkY += CHUNK_SIZE) {
+        for (int chunkX = startX; chunkX <= bounds.right(); chunkX += CHUNK_SIZE) {
+            const Chunk *chunk = tileLayer.findChunk(chunkX, chunkY);
+            if (!chunk)
+                continue;
+
+            chunkToGids(*chunk, chunkGids);
+
+            const QRect area = QRect(chunkX, chunkY, CHUNK_SIZE, CHUNK_SIZE) & bounds;
+            for (int y = area.top(); y <= area.bottom(); ++y) {
+                const unsigned *source = chunkGids + (y - chunkY) * CHUNK_SIZE + (area.left() - chunkX);
+                unsigned *target = gids.data() + (y - bounds.top()) * bounds.width() + (area.left() - bounds.left());
+                std::copy(source, source + area.width(), target);
+            }
+        }
+    }
+
+    return gids;
+}
+
+/**
+ * Converts all cells of the given \a chunk to global tile IDs, which are
+ * written to \a gids (CHUNK_SIZE * CHUNK_SIZE entries, row by row).
+ */
+void GidMapper::chunkToGids(const Chunk &chunk, unsigned *gids) const
+{
+    // Resolve the first GID of each tileset in the chunk's tileset table
+    QVarLengthArray<unsigned, 16> firstGids(chunk.mTilesets.size() + 1);
+    firstGids[0] = 0;
+    for (int i = 0; i < chunk.mTilesets.size(); ++i)
+        firstGids[i + 1] = mTilesetToFirstGid.value(chunk.mTilesets.at(i));
+
+    for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; ++i) {
+        const quint32 word = chunk.mGrid.at(i);
+        const int slot = static_cast<int>((word & Chunk::SlotMask) >> Chunk::SlotShift);
+        const unsigned firstGid = firstGids[slot];
+
+        if (firstGid == 0) {    // empty cell or unknown tileset
+            gids[i] = 0;
+            continue;
+        }
+
+        int tileId = static_cast<int>(word & Chunk::TileIdMask);
+        if (tileId == Chunk::LargeTileId)
+            tileId = chunk.mLargeTileIds.value(i);
+
+        gids[i] = (firstGid + tileId) |
+                gidFlagsForPackedFlags((word >> Chunk::FlagsShift) & 0x0F);
+    }
+}
+
 /**
  * Encodes the tile layer data of the given \a tileLayer in the given
  * \a format. This function should only be used for base64 encoding, with or
- * without compression.
+ * without compression. The \a compressionLevel is passed on to compress().
  */
 QByteArray GidMapper::encodeLayerData(const TileLayer &tileLayer,
                                       Map::LayerDataFormat format,
-                                      QRect bounds) const
+                                      QRect bounds,
+                                      int compressionLevel) const
 {
     Q_ASSERT(format != Map::XML);
     Q_ASSERT(format != Map::CSV);
@@ -157,31 +246,83 @@ QByteArray GidMapper::encodeLayerData(const TileLayer &tileLayer,
     if (bounds.isEmpty())
         bounds = QRect(0, 0, tileLayer.width(), tileLayer.height());
 
+    const QVector<unsigned> gids = cellsToGids(tileLayer, bounds);
+
     QByteArray tileData;
-    tileData.reserve(bounds.width() * bounds.height() * 4);
-
-    for (int y = bounds.top(); y <= bounds.bottom(); ++y) {
-        for (int x = bounds.left(); x <= bounds.right(); ++x) {
-            const unsigned gid = cellToGid(tileLayer.cellAt(x, y));
-            tileData.append(static_cast<char>(gid));
-            tileData.append(static_cast<char>(gid >> 8));
-            tileData.append(static_cast<char>(gid >> 16));
-            tileData.append(static_cast<char>(gid >> 24));
-        }
+    tileData.resize(gids.size() * 4);
+
+    char *data = tileData.data();
+    for (const unsigned gid : gids) {
+        *data++ = static_cast<char>(gid);
+        *data++ = static_cast<char>(gid >> 8);
+        *data++ = static_cast<char>(gid >> 16);
+        *data++ = static_cast<char>(gid >> 24);
     }
 
     if (format == Map::Base64Gzip)
-        tileData = compress(tileData, Gzip);
+        tileData = compress(tileData, Gzip, compressionLevel);
     else if (format == Map::Base64Zlib)
-        tileData = compress(tileData, Zlib);
+        tileData = compress(tileData, Zlib, compressionLevel);
+    else if (format == Map::Base64Zstandard)
+        tileData = compress(tileData, Zstandard, compressionLevel);
 
     return tileData.toBase64();
 }
 
+/**
+ * Encodes the given \a chunks of the \a tileLayer like encodeLayerData(),
+ * returning the encoded data in the same order as the chunks.
+ *
+ * The chunks are encoded and compressed in parallel on the global thread
+ * pool, since each of them is independent.
+ */
+QVector<QByteArray> GidMapper::encodeLayerChunks(const TileLayer &tileLayer,
+                                                 Map::LayerDataFormat format,
+                                                 const QVector<QRect> &chunks,
+                                                 int compressionLevel) const
+{
+    struct Job {
+        QRect bounds;
+        QByteArray data;
+    };
+
+    QVector<Job> jobs(chunks.size());
+    for (int i = 0; i < chunks.size(); ++i)
+        jobs[i].bounds = chunks.at(i);
+
+    QtConcurrent::blockingMap(jobs, [&] (Job &job) {
+        job.data = encodeLayerData(tileLayer, format, job.bounds, compressionLevel);
+    });
+
+    QVector<QByteArray> result;
+    result.reserve(jobs.size());
+    for (const Job &job : jobs)
+        result.append(job.data);
+
+    return result;
+}
+
 GidMapper::DecodeError GidMapper::decodeLayerData(TileLayer &tileLayer,
                                                   const QByteArray &layerData,
                                                   Map::LayerDataFormat format,
                                                   QRect bounds) const
+{
+    return decodeRawLayerData(tileLayer,
+                              decompressLayerData(layerData, format, bounds),
+                              bounds);
+}
+
+/**
+ * Decodes the base64 encoded \a layerData and decompresses it according to
+ * the given \a format, returning the raw tile layer data for \a bounds.
+ *
+ * Does not depend on any GidMapper state, so it may be called from multiple
+ * threads. Returns data of unexpected size in case of corruption, which is
+ * reported by decodeRawLayerData().
+ */
+QByteArray GidMapper::decompressLayerData(const QByteArray &layerData,
+                                          Map::LayerDataFormat format,
+                                          QRect bounds)
 {
     Q_ASSERT(format != Map::XML);
     Q_ASSERT(format != Map::CSV);
@@ -191,34 +332,53 @@ GidMapper::DecodeError GidMapper::decodeLayerData(TileLayer &tileLayer,
 
     if (format == Map::Base64Gzip || format == Map::Base64Zlib)
         decodedData = decompress(decodedData, size);
+    else if (format == Map::Base64Zstandard)
+        decodedData = decompress(decodedData, size, Zstandard);
+
+    return decodedData;
+}
 
-    if (size != decodedData.length())
+/**
+ * Sets the cells of \a tileLayer within \a bounds from the given
+ * \a rawData, which holds 4 bytes per tile as returned by
+ * decompressLayerData().
+ */
+GidMapper::DecodeError GidMapper::decodeRawLayerData(TileLayer &tileLayer,
+                                                     const QByteArray &rawData,
+                                                     QRect bounds) const
+{
+    const int size = bounds.width() * bounds.height() * 4;
+    if (size != rawData.length())
         return CorruptLayerData;
 
-    const unsigned char *data = reinterpret_cast<const unsigned char*>(decodedData.constData());
-    int x = bounds.x();
-    int y = bounds.y();
+    const unsigned char *data = reinterpret_cast<const unsigned char*>(rawData.constData());
     bool ok;
 
-    for (int i = 0; i < size - 3; i += 4) {
-        const unsigned gid = data[i] |
-                             data[i + 1] << 8 |
-                             data[i + 2] << 16 |
-                             data[i + 3] << 24;
+    // Cells are decoded and set one strip of chunk rows at a time, to avoid
+    // both per-cell chunk lookups and a large temporary buffer.
+    QVector<Cell> cells;
 
-        const Cell result = gidToCell(gid, ok);
-        if (!ok) {
-            mInvalidTile = gid;
-            return isEmpty() ? TileButNoTilesets : InvalidTile;
-        }
+    for (int stripY = bounds.top(); stripY <= bounds.bottom(); stripY += CHUNK_SIZE) {
+        const int stripHeight = std::min(CHUNK_SIZE, bounds.bottom() + 1 - stripY);
+        const QRect strip(bounds.left(), stripY, bounds.width(), stripHeight);
+
+        cells.resize(strip.width() * strip.height());
 
-        tileLayer.setCell(x, y, result);
+        for (Cell &cell : cells) {
+            const unsigned gid = data[0] |
+                                 data[1] << 8 |
+                                 data[2] << 16 |
+                                 data[3] << 24;
+            data += 4;
 
-        x++;
-        if (x > bounds.right()) {
-            x = bounds.x();
-            y++;
+            cell = gidToCell(gid, ok);
+            if (!ok) {
+                mInvalidTile = gid;
+                return isEmpty() ? TileButNoTilesets : InvalidTile;
+            }
         }
+
+        tileLayer.setCells(strip, cells.constData());
     }
 
     return NoError;
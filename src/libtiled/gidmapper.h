@@ -31,6 +31,7 @@
 #include "map.h"
 #include "tilelayer.h"
 
+#include <QHash>
 #include <QMap>
 
 namespace Tiled {
@@ -51,9 +52,18 @@ public:
     Cell gidToCell(unsigned gid, bool &ok) const;
     unsigned cellToGid(const Cell &cell) const;
 
+    QVector<unsigned> cellsToGids(const TileLayer &tileLayer,
+                                  QRect bounds) const;
+
     QByteArray encodeLayerData(const TileLayer &tileLayer,
                                Map::LayerDataFormat format,
-                               QRect bounds = QRect()) const;
+                               QRect bounds = QRect(),
+                               int compressionLevel = -1) const;
+
+    QVector<QByteArray> encodeLayerChunks(const TileLayer &tileLayer,
+                                          Map::LayerDataFormat format,
+                                          const QVector<QRect> &chunks,
+                                          int compressionLevel = -1) const;
 
     enum DecodeError {
         NoError = 0,
@@ -67,10 +77,21 @@ public:
                                 Map::LayerDataFormat format,
                                 QRect bounds) const;
 
+    static QByteArray decompressLayerData(const QByteArray &layerData,
+                                          Map::LayerDataFormat format,
+                                          QRect bounds);
+
+    DecodeError decodeRawLayerData(TileLayer &tileLayer,
+                                   const QByteArray &rawData,
+                                   QRect bounds) const;
+
     unsigned invalidTile() const;
 
 private:
+    void chunkToGids(const Chunk &chunk, unsigned *gids) const;
+
     QMap<unsigned, SharedTileset> mFirstGidToTileset;
+    QHash<const Tileset*, unsigned> mTilesetToFirstGid;
 
     mutable unsigned mInvalidTile;
 };
@@ -82,6 +103,13 @@ private:
 inline void GidMapper::insert(unsigned firstGid, const SharedTileset &tileset)
 {
     mFirstGidToTileset.insert(firstGid, tileset);
+
+    // When a tileset is inserted more than once, its lowest first GID is used
+    auto it = mTilesetToFirstGid.find(tileset.data());
+    if (it == mTilesetToFirstGid.end())
+        mTilesetToFirstGid.insert(tileset.data(), firstGid);
+    else if (firstGid < it.value())
+        it.value() = firstGid;
 }
 
 /**
@@ -90,6 +118,7 @@ inline void GidMapper::insert(unsigned firstGid, const SharedTileset &tileset)
 inline void GidMapper::clear()
 {
     mFirstGidToTileset.clear();
+    mTilesetToFirstGid.clear();
 }
 
 /**
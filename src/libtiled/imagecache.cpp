@@ -29,6 +29,13 @@
 #include "imagecache.h"
 
 #include <QBitmap>
+#include <QCache>
+#include <QCoreApplication>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <climits>
 
 namespace Tiled {
 
@@ -54,24 +61,188 @@ uint qHash(const TilesheetParameters &key, uint seed) Q_DECL_NOTHROW
 }
 
 
-QHash<QString, QImage> ImageCache::sLoadedImages;
-QHash<QString, QPixmap> ImageCache::sLoadedPixmaps;
-QHash<TilesheetParameters, QVector<QPixmap>> ImageCache::sCutTiles;
+namespace {
+
+enum EntryKind {
+    PixmapEntry,
+    CutTilesEntry,
+    AtlasEntry
+};
+
+struct CacheKey
+{
+    EntryKind kind;
+    TilesheetParameters parameters;     // Only fileName is used for pixmaps
+
+    bool operator==(const CacheKey &other) const
+    { return kind == other.kind && parameters == other.parameters; }
+};
+
+uint qHash(const CacheKey &key, uint seed = 0) Q_DECL_NOTHROW
+{
+    return Tiled::qHash(key.parameters, ::qHash(static_cast<int>(key.kind), seed));
+}
+
+struct PixmapCacheEntry
+{
+    QPixmap pixmap;
+    QVector<QPixmap> tiles;
+};
+
+qint64 imageBytes(const QImage &image)
+{
+    return qint64(image.bytesPerLine()) * image.height();
+}
+
+qint64 pixmapBytes(const QPixmap &pixmap)
+{
+    return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+qint64 entryBytes(const PixmapCacheEntry &entry)
+{
+    qint64 bytes = pixmapBytes(entry.pixmap);
+    for (const QPixmap &tile : entry.tiles)
+        bytes += pixmapBytes(tile);
+    return bytes;
+}
 
+int costFromBytes(qint64 bytes)
+{
+    return static_cast<int>(qBound<qint64>(1, bytes / 1024, INT_MAX));
+}
+
+const qint64 DefaultMemoryLimit = 512 * 1024 * 1024;
+
+/*
+ * Images and pixmaps are kept in separate caches, which share the memory
+ * limit equally. Images may be inserted from any thread, which can only ever
+ * evict other images. Pixmaps may only be created and destroyed on the GUI
+ * thread, so the pixmap cache is only touched from there.
+ *
+ * The cost of the entries is in kilobytes, since QCache uses int for costs.
+ */
+QMutex sMutex;
+QCache<QString, QImage> sImageCache(DefaultMemoryLimit / 2 / 1024);
+QCache<CacheKey, PixmapCacheEntry> sPixmapCache(DefaultMemoryLimit / 2 / 1024);
+ImageCache::Statistics sStatistics;
+
+bool isGuiThread()
+{
+    const QCoreApplication *app = QCoreApplication::instance();
+    return !app || QThread::currentThread() == app->thread();
+}
+
+/**
+ * Inserts \a object into \a cache, dropping the least recently used entries
+ * when necessary. Has to be called with sMutex locked.
+ */
+template<typename Key, typename T>
+void insertEntry(QCache<Key, T> &cache, const Key &key, const T &object, qint64 bytes)
+{
+    const int countBefore = cache.count() - (cache.contains(key) ? 1 : 0);
+    if (cache.insert(key, new T(object), costFromBytes(bytes)))
+        sStatistics.evictions += countBefore + 1 - cache.count();
+}
+
+/**
+ * Looks up the pixmap entry for the given \a key, and copies it to \a entry
+ * when found. Has to be called with sMutex locked.
+ */
+bool findPixmapEntry(const CacheKey &key, PixmapCacheEntry &entry)
+{
+    if (const PixmapCacheEntry *cached = sPixmapCache.object(key)) {
+        entry = *cached;
+        ++sStatistics.hits;
+        return true;
+    }
+
+    ++sStatistics.misses;
+    return false;
+}
+
+void insertPixmapEntry(const CacheKey &key, const PixmapCacheEntry &entry)
+{
+    Q_ASSERT(isGuiThread());
+    QMutexLocker locker(&sMutex);
+    insertEntry(sPixmapCache, key, entry, entryBytes(entry));
+}
+
+CacheKey makeKey(EntryKind kind, const QString &fileName)
+{
+    CacheKey key { kind, TilesheetParameters() };
+    key.parameters.fileName = fileName;
+    return key;
+}
+
+} // anonymous namespace
+
+/**
+ * Returns the image loaded from the given \a fileName. This function may be
+ * called from any thread.
+ */
 QImage ImageCache::loadImage(const QString &fileName)
 {
-    auto it = sLoadedImages.find(fileName);
-    if (it == sLoadedImages.end())
-        it = sLoadedImages.insert(fileName, QImage(fileName));
-    return it.value();
+    {
+        QMutexLocker locker(&sMutex);
+        if (const QImage *cached = sImageCache.object(fileName)) {
+            ++sStatistics.hits;
+            return *cached;
+        }
+        ++sStatistics.misses;
+    }
+
+    // Decode without holding the lock, so images can be loaded in parallel
+    const QImage image(fileName);
+
+    QMutexLocker locker(&sMutex);
+    insertEntry(sImageCache, fileName, image, imageBytes(image));
+    return image;
 }
 
 QPixmap ImageCache::loadPixmap(const QString &fileName)
 {
-    auto it = sLoadedPixmaps.find(fileName);
-    if (it == sLoadedPixmaps.end())
-        it = sLoadedPixmaps.insert(fileName, QPixmap::fromImage(loadImage(fileName)));
-    return it.value();
+    Q_ASSERT(isGuiThread());
+
+    const CacheKey key = makeKey(PixmapEntry, fileName);
+    PixmapCacheEntry entry;
+
+    {
+        QMutexLocker locker(&sMutex);
+        if (findPixmapEntry(key, entry))
+            return entry.pixmap;
+    }
+
+    entry.pixmap = QPixmap::fromImage(loadImage(fileName));
+    insertPixmapEntry(key, entry);
+    return entry.pixmap;
+}
+
+/**
+ * Returns the cached pixmap for \a fileName, or a null pixmap when it is not
+ * in the cache. Unlike loadPixmap(), this never loads the image.
+ */
+QPixmap ImageCache::findPixmap(const QString &fileName)
+{
+    Q_ASSERT(isGuiThread());
+
+    PixmapCacheEntry entry;
+
+    QMutexLocker locker(&sMutex);
+    findPixmapEntry(makeKey(PixmapEntry, fileName), entry);
+    return entry.pixmap;
+}
+
+/**
+ * Adds the given \a pixmap to the cache, as if it was loaded from
+ * \a fileName. Useful when the image was decoded elsewhere, for example on
+ * a worker thread.
+ */
+void ImageCache::insertPixmap(const QString &fileName, const QPixmap &pixmap)
+{
+    PixmapCacheEntry entry;
+    entry.pixmap = pixmap;
+    insertPixmapEntry(makeKey(PixmapEntry, fileName), entry);
 }
 
 static QVector<QPixmap> cutTilesImpl(const TilesheetParameters &p)
@@ -103,23 +274,113 @@ static QVector<QPixmap> cutTilesImpl(const TilesheetParameters &p)
 
 QVector<QPixmap> ImageCache::cutTiles(const TilesheetParameters &parameters)
 {
-    auto it = sCutTiles.find(parameters);
-    if (it == sCutTiles.end())
-        it = sCutTiles.insert(parameters, cutTilesImpl(parameters));
-    return it.value();
+    Q_ASSERT(isGuiThread());
+
+    const CacheKey key { CutTilesEntry, parameters };
+    PixmapCacheEntry entry;
+
+    {
+        QMutexLocker locker(&sMutex);
+        if (findPixmapEntry(key, entry))
+            return entry.tiles;
+    }
+
+    entry.tiles = cutTilesImpl(parameters);
+    insertPixmapEntry(key, entry);
+    return entry.tiles;
 }
 
-void ImageCache::remove(const QString &fileName)
+/**
+ * Returns the tilesheet as a single pixmap, with the transparent color
+ * masked out. The tiles returned by cutTiles() can be drawn from this
+ * pixmap, which allows drawing different tiles in a single call.
+ */
+QPixmap ImageCache::loadAtlas(const TilesheetParameters &parameters)
 {
-    sLoadedImages.remove(fileName);
-    sLoadedPixmaps.remove(fileName);
+    if (!parameters.transparentColor.isValid())
+        return loadPixmap(parameters.fileName);
+
+    Q_ASSERT(isGuiThread());
+
+    const CacheKey key { AtlasEntry, parameters };
+    PixmapCacheEntry entry;
+
+    {
+        QMutexLocker locker(&sMutex);
+        if (findPixmapEntry(key, entry))
+            return entry.pixmap;
+    }
 
-    // Also remove any previously cut tiles
-    QMutableHashIterator<TilesheetParameters, QVector<QPixmap>> it(sCutTiles);
-    while (it.hasNext()) {
-        if (it.next().key().fileName == fileName)
-            it.remove();
+    const QImage image(loadImage(parameters.fileName));
+    entry.pixmap = QPixmap::fromImage(image);
+    if (!entry.pixmap.isNull()) {
+        const QImage mask = image.createMaskFromColor(parameters.transparentColor.rgb());
+        entry.pixmap.setMask(QBitmap::fromImage(mask));
     }
+
+    insertPixmapEntry(key, entry);
+    return entry.pixmap;
+}
+
+/**
+ * Removes all entries loaded from the given \a fileName, including any tiles
+ * cut from it.
+ */
+void ImageCache::remove(const QString &fileName)
+{
+    Q_ASSERT(isGuiThread());
+    QMutexLocker locker(&sMutex);
+
+    sImageCache.remove(fileName);
+
+    const auto keys = sPixmapCache.keys();
+    for (const CacheKey &key : keys)
+        if (key.parameters.fileName == fileName)
+            sPixmapCache.remove(key);
+}
+
+void ImageCache::clear()
+{
+    Q_ASSERT(isGuiThread());
+    QMutexLocker locker(&sMutex);
+    sImageCache.clear();
+    sPixmapCache.clear();
+}
+
+/**
+ * Returns the amount of memory in bytes the cache may use.
+ */
+qint64 ImageCache::memoryLimit()
+{
+    QMutexLocker locker(&sMutex);
+    return (qint64(sImageCache.maxCost()) + sPixmapCache.maxCost()) * 1024;
+}
+
+/**
+ * Sets the amount of memory in bytes the cache may use, shared equally
+ * between images and pixmaps. Least recently used entries are dropped until
+ * the cache fits. 0 disables the cache.
+ */
+void ImageCache::setMemoryLimit(qint64 bytes)
+{
+    Q_ASSERT(isGuiThread());
+    QMutexLocker locker(&sMutex);
+
+    const int maxCost = static_cast<int>(qBound<qint64>(0, bytes / 2 / 1024, INT_MAX));
+    const int countBefore = sImageCache.count() + sPixmapCache.count();
+    sImageCache.setMaxCost(maxCost);
+    sPixmapCache.setMaxCost(maxCost);
+    sStatistics.evictions += countBefore - sImageCache.count() - sPixmapCache.count();
+}
+
+ImageCache::Statistics ImageCache::statistics()
+{
+    QMutexLocker locker(&sMutex);
+
+    Statistics statistics = sStatistics;
+    statistics.memoryUsage = (qint64(sImageCache.totalCost()) + sPixmapCache.totalCost()) * 1024;
+    statistics.entries = sImageCache.count() + sPixmapCache.count();
+    return statistics;
 }
 
 } // namespace Tiled
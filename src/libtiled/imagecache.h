@@ -53,18 +53,46 @@ struct TILEDSHARED_EXPORT TilesheetParameters
 
 uint TILEDSHARED_EXPORT qHash(const TilesheetParameters &key, uint seed = 0) Q_DECL_NOTHROW;
 
+/**
+ * Caches loaded images, pixmaps and cut tiles, to avoid loading the same
+ * image more than once.
+ *
+ * The cache is bounded by a memory limit. When it is exceeded, the least
+ * recently used entries are dropped. Since images and pixmaps are implicitly
+ * shared, entries that are still in use elsewhere stay in memory until they
+ * are no longer used.
+ *
+ * Images and pixmaps are kept in separate caches. loadImage() and
+ * statistics() may be called from any thread, and can only cause other
+ * images to be dropped. All other functions create or drop pixmaps, so they
+ * may only be called from the GUI thread.
+ */
 class TILEDSHARED_EXPORT ImageCache
 {
 public:
+    struct Statistics
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 evictions = 0;
+        qint64 memoryUsage = 0;     // In bytes
+        int entries = 0;
+    };
+
     static QImage loadImage(const QString &fileName);
     static QPixmap loadPixmap(const QString &fileName);
+    static QPixmap findPixmap(const QString &fileName);
+    static void insertPixmap(const QString &fileName, const QPixmap &pixmap);
     static QVector<QPixmap> cutTiles(const TilesheetParameters &parameters);
+    static QPixmap loadAtlas(const TilesheetParameters &parameters);
 
     static void remove(const QString &fileName);
+    static void clear();
+
+    static qint64 memoryLimit();
+    static void setMemoryLimit(qint64 bytes);
 
-    static QHash<QString, QImage> sLoadedImages;
-    static QHash<QString, QPixmap> sLoadedPixmaps;
-    static QHash<TilesheetParameters, QVector<QPixmap>> sCutTiles;
+    static Statistics statistics();
 };
 
 } // namespace Tiled
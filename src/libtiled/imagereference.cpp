@@ -42,4 +42,20 @@ QPixmap ImageReference::create() const
     return QPixmap();
 }
 
+/**
+ * Returns the referenced image as a QImage. Unlike create(), this function
+ * may be called from any thread.
+ */
+QImage ImageReference::createImage() const
+{
+    if (source.isLocalFile())
+        return ImageCache::loadImage(source.toLocalFile());
+    else if (source.scheme() == QLatin1String("qrc"))
+        return ImageCache::loadImage(QLatin1Char(':') + source.path());
+    else if (!data.isEmpty())
+        return QImage::fromData(data, format);
+
+    return QImage();
+}
+
 } // namespace Tiled
@@ -42,6 +42,7 @@ public:
 
     bool hasImage() const;
     QPixmap create() const;
+    QImage createImage() const;
 };
 
 } // namespace Tiled
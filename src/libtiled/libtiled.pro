@@ -2,6 +2,7 @@ include(../../tiled.pri)
 
 TEMPLATE = lib
 TARGET = tiled
+QT += concurrent
 target.path = $${LIBDIR}
 INSTALLS += target
 macx {
@@ -20,6 +21,17 @@ win32 {
     LIBS += -lz
 }
 
+# Zstandard compression of layer data is optional
+!contains(DISABLE_ZSTD, yes) {
+    unix {
+        packagesExist(libzstd) {
+            DEFINES += TILED_ZSTD_SUPPORT
+            CONFIG += link_pkgconfig
+            PKGCONFIG += libzstd
+        }
+    }
+}
+
 DEFINES += QT_NO_CAST_FROM_ASCII \
     QT_NO_CAST_TO_ASCII
 DEFINES += TILED_LIBRARY
@@ -30,6 +30,7 @@
 
 #include "map.h"
 
+#include "compression.h"
 #include "layer.h"
 #include "objectgroup.h"
 #include "objecttemplate.h"
@@ -37,6 +38,7 @@
 #include "tilelayer.h"
 #include "mapobject.h"
 
+#include <QDebug>
 #include <QtMath>
 
 using namespace Tiled;
@@ -56,6 +58,7 @@ Map::Map(Orientation orientation,
     mStaggerIndex(StaggerOdd),
     mDrawMarginsDirty(true),
     mLayerDataFormat(Base64Zlib),
+    mCompressionLevel(-1),
     mNextLayerId(1),
     mNextObjectId(1)
 {
@@ -87,6 +90,7 @@ Map::Map(const Map &map):
     mDrawMarginsDirty(map.mDrawMarginsDirty),
     mTilesets(map.mTilesets),
     mLayerDataFormat(map.mLayerDataFormat),
+    mCompressionLevel(map.mCompressionLevel),
     mNextObjectId(1)
 {
     for (const Layer *layer : map.mLayers) {
@@ -101,6 +105,23 @@ Map::~Map()
     qDeleteAll(mLayers);
 }
 
+/**
+ * Returns the layer data format that should be used when writing this map.
+ * This is the map's layer data format, unless it uses a compression method
+ * that is not supported by this build, in which case it falls back to zlib
+ * compression.
+ */
+Map::LayerDataFormat Map::layerDataFormatForWriting() const
+{
+    if (mLayerDataFormat == Base64Zstandard && !compressionSupported(Zstandard)) {
+        qWarning() << "Zstandard compression is not supported by this build,"
+                      " writing zlib compressed layer data instead";
+        return Base64Zlib;
+    }
+
+    return mLayerDataFormat;
+}
+
 QMargins Map::drawMargins() const
 {
     if (mDrawMarginsDirty)
@@ -79,7 +79,8 @@ public:
         Base64     = 1,
         Base64Gzip = 2,
         Base64Zlib = 3,
-        CSV        = 4
+        CSV        = 4,
+        Base64Zstandard = 5
     };
 
     /**
@@ -400,6 +401,17 @@ public:
     void setLayerDataFormat(LayerDataFormat format)
     { mLayerDataFormat = format; }
 
+    LayerDataFormat layerDataFormatForWriting() const;
+
+    /**
+     * Returns the compression level used for compressed layer data. The
+     * default (-1) uses the default level of the compression method.
+     */
+    int compressionLevel() const
+    { return mCompressionLevel; }
+    void setCompressionLevel(int compressionLevel)
+    { mCompressionLevel = compressionLevel; }
+
     void setNextLayerId(int nextId);
     int nextLayerId() const;
     int takeNextLayerId();
@@ -434,6 +446,7 @@ private:
     QList<Layer*> mLayers;
     QVector<SharedTileset> mTilesets;
     LayerDataFormat mLayerDataFormat;
+    int mCompressionLevel;
     int mNextLayerId;
     int mNextObjectId;
 };
@@ -116,6 +116,26 @@ const QString &MapObject::effectiveType() const
     return mType;
 }
 
+/**
+ * Returns the object type matching the effective type of this object, or
+ * nullptr when there is no such type. Type names are compared
+ * case-insensitively.
+ *
+ * The result is cached, since this is needed each time the object is drawn.
+ */
+const ObjectType *MapObject::effectiveObjectType() const
+{
+    const QString &type = effectiveType();
+
+    if (mCachedTypeRevision != objectTypesRevision() || mCachedTypeName != type) {
+        mCachedTypeName = type;
+        mCachedTypeIndex = objectTypeIndex(type, Qt::CaseInsensitive);
+        mCachedTypeRevision = objectTypesRevision();
+    }
+
+    return mCachedTypeIndex == -1 ? nullptr : &objectTypes().at(mCachedTypeIndex);
+}
+
 /**
  * Sets the text data associated with this object.
  */
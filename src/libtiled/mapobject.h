@@ -136,6 +136,7 @@ public:
     void setType(const QString &type);
 
     const QString &effectiveType() const;
+    const ObjectType *effectiveObjectType() const;
 
     const QPointF &position() const;
     void setPosition(const QPointF &pos);
@@ -234,6 +235,11 @@ private:
     bool mVisible;
     bool mTemplateBase;
     ChangedProperties mChangedProperties;
+
+    // Cached result of effectiveObjectType()
+    mutable QString mCachedTypeName;
+    mutable int mCachedTypeIndex = -1;
+    mutable int mCachedTypeRevision = -1;
 };
 
 /**
@@ -33,11 +33,13 @@
 #include "compression.h"
 #include "gidmapper.h"
 #include "grouplayer.h"
+#include "imagecache.h"
 #include "imagelayer.h"
 #include "objectgroup.h"
 #include "objecttemplate.h"
 #include "map.h"
 #include "mapobject.h"
+#include "qtcompat_p.h"
 #include "templatemanager.h"
 #include "tile.h"
 #include "tilelayer.h"
@@ -51,10 +53,18 @@
 #include <QFileInfo>
 #include <QVector>
 #include <QXmlStreamReader>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <climits>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+// Number of binary chunks of an infinite map that are decompressed in
+// parallel at once
+static const int ChunkBatchSize = 1024;
+
 namespace Tiled {
 namespace Internal {
 
@@ -84,7 +94,14 @@ private:
     Map *readMap();
 
     SharedTileset readTileset();
-    void readTilesetTile(Tileset &tileset);
+    struct TileImage {
+        Tile *tile;
+        ImageReference reference;
+        QImage image;
+    };
+
+    void readTilesetTile(Tileset &tileset, QVector<TileImage> &tileImages);
+    void loadTileImages(Tileset &tileset, QVector<TileImage> &tileImages);
     void readTilesetGrid(Tileset &tileset);
     void readTilesetImage(Tileset &tileset);
     void readTilesetTerrainTypes(Tileset &tileset);
@@ -105,6 +122,17 @@ private:
                                const QByteArray &data,
                                Map::LayerDataFormat format,
                                QRect bounds);
+
+    struct BinaryChunk {
+        QRect bounds;
+        QByteArray data;
+    };
+
+    void decodeBinaryLayerChunks(TileLayer &tileLayer,
+                                 QVector<BinaryChunk> &chunks,
+                                 Map::LayerDataFormat format);
+    void reportDecodeError(const TileLayer &tileLayer,
+                           GidMapper::DecodeError error);
     void decodeCSVLayerData(TileLayer &tileLayer,
                             QStringRef text,
                             QRect bounds);
@@ -270,6 +298,9 @@ Map *MapReaderPrivate::readMap()
     const Map::RenderOrder renderOrder =
             renderOrderFromString(renderOrderString);
 
+    bool compressionLevelOk;
+    const int compressionLevel = atts.value(QLatin1String("compressionlevel")).toInt(&compressionLevelOk);
+
     const int nextLayerId = atts.value(QLatin1String("nextlayerid")).toInt();
     const int nextObjectId = atts.value(QLatin1String("nextobjectid")).toInt();
 
@@ -278,6 +309,8 @@ Map *MapReaderPrivate::readMap()
     mMap->setStaggerAxis(staggerAxis);
     mMap->setStaggerIndex(staggerIndex);
     mMap->setRenderOrder(renderOrder);
+    if (compressionLevelOk)
+        mMap->setCompressionLevel(compressionLevel);
     if (nextLayerId)
         mMap->setNextLayerId(nextLayerId);
     if (nextObjectId)
@@ -362,9 +395,11 @@ SharedTileset MapReaderPrivate::readTileset()
             if (!bgColorString.isEmpty())
                 tileset->setBackgroundColor(QColor(bgColorString.toString()));
 
+            QVector<TileImage> tileImages;
+
             while (xml.readNextStartElement()) {
                 if (xml.name() == QLatin1String("tile")) {
-                    readTilesetTile(*tileset);
+                    readTilesetTile(*tileset, tileImages);
                 } else if (xml.name() == QLatin1String("tileoffset")) {
                     const QXmlStreamAttributes oa = xml.attributes();
                     int x = oa.value(QLatin1String("x")).toInt();
@@ -392,6 +427,9 @@ SharedTileset MapReaderPrivate::readTileset()
                     readUnknownElement();
                 }
             }
+
+            if (tileset)
+                loadTileImages(*tileset, tileImages);
         }
     } else { // External tileset
         const QString absoluteSource = p->resolveReference(source, mPath);
@@ -414,7 +452,8 @@ SharedTileset MapReaderPrivate::readTileset()
     return tileset;
 }
 
-void MapReaderPrivate::readTilesetTile(Tileset &tileset)
+void MapReaderPrivate::readTilesetTile(Tileset &tileset,
+                                       QVector<TileImage> &tileImages)
 {
     Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("tile"));
 
@@ -452,13 +491,17 @@ void MapReaderPrivate::readTilesetTile(Tileset &tileset)
             tile->mergeProperties(readProperties());
         } else if (xml.name() == QLatin1String("image")) {
             ImageReference imageReference = readImage();
-            if (imageReference.hasImage()) {
-                QPixmap image = imageReference.create();
-                if (image.isNull()) {
-                    if (imageReference.source.isEmpty())
+            if (imageReference.source.isEmpty()) {
+                if (imageReference.hasImage()) {
+                    QPixmap image = imageReference.create();
+                    if (image.isNull())
                         xml.raiseError(tr("Error reading embedded image for tile %1").arg(id));
+                    tileset.setTileImage(tile, image, imageReference.source);
                 }
-                tileset.setTileImage(tile, image, imageReference.source);
+            } else {
+                // Image files are loaded after reading the tileset, see
+                // loadTileImages
+                tileImages.append(TileImage { tile, imageReference, QImage() });
             }
         } else if (xml.name() == QLatin1String("objectgroup")) {
             ObjectGroup *objectGroup = readObjectGroup();
@@ -505,6 +548,67 @@ void MapReaderPrivate::readTilesetTile(Tileset &tileset)
     }
 }
 
+/**
+ * Decodes the image files of the tiles in an image collection tileset on
+ * multiple threads, and then sets them on their tiles, in order.
+ */
+/**
+ * Returns the file name under which the image at \a source is stored in the
+ * ImageCache, or an empty string for images that are not cached.
+ */
+static QString cacheFileName(const QUrl &source)
+{
+    if (source.isLocalFile())
+        return source.toLocalFile();
+    if (source.scheme() == QLatin1String("qrc"))
+        return QLatin1Char(':') + source.path();
+    return QString();
+}
+
+void MapReaderPrivate::loadTileImages(Tileset &tileset,
+                                      QVector<TileImage> &tileImages)
+{
+    if (tileImages.isEmpty() || xml.hasError())
+        return;
+
+    // Use the pixmaps that are already cached and only decode the others
+    QVector<TileImage> uncachedImages;
+
+    for (const TileImage &tileImage : qAsConst(tileImages)) {
+        const QUrl &source = tileImage.reference.source;
+        const QString fileName = cacheFileName(source);
+        const QPixmap pixmap = fileName.isEmpty() ? QPixmap()
+                                                  : ImageCache::findPixmap(fileName);
+        if (pixmap.isNull())
+            uncachedImages.append(tileImage);
+        else
+            tileset.setTileImage(tileImage.tile, pixmap, source);
+    }
+
+    QtConcurrent::blockingMap(uncachedImages, [] (TileImage &tileImage) {
+        tileImage.image = tileImage.reference.createImage();
+    });
+
+    // Pixmaps can only be created on the GUI thread
+    for (const TileImage &tileImage : qAsConst(uncachedImages)) {
+        const QUrl &source = tileImage.reference.source;
+        const QString fileName = cacheFileName(source);
+        QPixmap pixmap;
+
+        // Share the pixmap with other tiles referring to the same file
+        if (!fileName.isEmpty())
+            pixmap = ImageCache::findPixmap(fileName);
+
+        if (pixmap.isNull()) {
+            pixmap = QPixmap::fromImage(tileImage.image);
+            if (!fileName.isEmpty())
+                ImageCache::insertPixmap(fileName, pixmap);
+        }
+
+        tileset.setTileImage(tileImage.tile, pixmap, source);
+    }
+}
+
 void MapReaderPrivate::readTilesetGrid(Tileset &tileset)
 {
     Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("grid"));
@@ -777,6 +881,9 @@ void MapReaderPrivate::readTileLayerData(TileLayer &tileLayer)
             layerDataFormat = Map::Base64Gzip;
         } else if (compression == QLatin1String("zlib")) {
             layerDataFormat = Map::Base64Zlib;
+        } else if (compression == QLatin1String("zstd")
+                   && compressionSupported(Zstandard)) {
+            layerDataFormat = Map::Base64Zstandard;
         } else {
             xml.raiseError(tr("Compression method '%1' not supported")
                            .arg(compression.toString()));
@@ -790,6 +897,12 @@ void MapReaderPrivate::readTileLayerData(TileLayer &tileLayer)
     mMap->setLayerDataFormat(layerDataFormat);
 
     if (mMap->infinite()) {
+        const bool binary = encoding == QLatin1String("base64");
+
+        // Binary chunks are collected and decompressed in parallel, a batch
+        // at a time
+        QVector<BinaryChunk> binaryChunks;
+
         while (xml.readNext() != QXmlStreamReader::Invalid) {
             if (xml.isEndElement()) {
                 break;
@@ -800,11 +913,25 @@ void MapReaderPrivate::readTileLayerData(TileLayer &tileLayer)
                     int y = atts.value(QLatin1String("y")).toInt();
                     int width = atts.value(QLatin1String("width")).toInt();
                     int height = atts.value(QLatin1String("height")).toInt();
+                    const QRect bounds(x, y, width, height);
+
+                    if (binary) {
+                        const QString text = xml.readElementText(QXmlStreamReader::SkipChildElements);
+                        if (!text.trimmed().isEmpty())
+                            binaryChunks.append(BinaryChunk { bounds, text.toLatin1() });
 
-                    readTileLayerRect(tileLayer, layerDataFormat, encoding, QRect(x, y, width, height));
+                        if (binaryChunks.size() == ChunkBatchSize) {
+                            decodeBinaryLayerChunks(tileLayer, binaryChunks, layerDataFormat);
+                            binaryChunks.clear();
+                        }
+                    } else {
+                        readTileLayerRect(tileLayer, layerDataFormat, encoding, bounds);
+                    }
                 }
             }
         }
+
+        decodeBinaryLayerChunks(tileLayer, binaryChunks, layerDataFormat);
     } else {
         readTileLayerRect(tileLayer, layerDataFormat, encoding, QRect(0, 0, tileLayer.width(), tileLayer.height()));
     }
@@ -815,28 +942,26 @@ void MapReaderPrivate::readTileLayerRect(TileLayer &tileLayer,
                                          QStringRef encoding,
                                          QRect bounds)
 {
-    int x = bounds.x();
-    int y = bounds.y();
+    // Cells from <tile> elements are collected and set in one go at the end
+    QVector<Cell> cells;
+    int tileIndex = 0;
 
     while (xml.readNext() != QXmlStreamReader::Invalid) {
         if (xml.isEndElement()) {
             break;
         } else if (xml.isStartElement()) {
             if (xml.name() == QLatin1String("tile")) {
-                if (y >= bounds.bottom() + 1) {
+                if (cells.isEmpty())
+                    cells.resize(bounds.width() * bounds.height());
+
+                if (tileIndex >= cells.size()) {
                     xml.raiseError(tr("Too many <tile> elements"));
                     continue;
                 }
 
                 const QXmlStreamAttributes atts = xml.attributes();
                 unsigned gid = atts.value(QLatin1String("gid")).toUInt();
-                tileLayer.setCell(x, y, cellForGid(gid));
-
-                x++;
-                if (x >= bounds.right() + 1) {
-                    x = bounds.x();
-                    y++;
-                }
+                cells[tileIndex++] = cellForGid(gid);
 
                 xml.skipCurrentElement();
             } else {
@@ -853,6 +978,9 @@ void MapReaderPrivate::readTileLayerRect(TileLayer &tileLayer,
             }
         }
     }
+
+    if (tileIndex > 0)
+        tileLayer.setCells(bounds, cells.constData());
 }
 
 void MapReaderPrivate::decodeBinaryLayerData(TileLayer &tileLayer,
@@ -860,10 +988,37 @@ void MapReaderPrivate::decodeBinaryLayerData(TileLayer &tileLayer,
                                              Map::LayerDataFormat format,
                                              QRect bounds)
 {
-    GidMapper::DecodeError error;
+    reportDecodeError(tileLayer,
+                      mGidMapper.decodeLayerData(tileLayer, data, format, bounds));
+}
+
+/**
+ * Decompresses the given binary \a chunks on multiple threads and then sets
+ * their cells on the \a tileLayer, in order.
+ */
+void MapReaderPrivate::decodeBinaryLayerChunks(TileLayer &tileLayer,
+                                               QVector<BinaryChunk> &chunks,
+                                               Map::LayerDataFormat format)
+{
+    if (chunks.isEmpty() || xml.hasError())
+        return;
+
+    QtConcurrent::blockingMap(chunks, [format] (BinaryChunk &chunk) {
+        chunk.data = GidMapper::decompressLayerData(chunk.data, format, chunk.bounds);
+    });
 
-    error = mGidMapper.decodeLayerData(tileLayer, data, format, bounds);
+    for (const BinaryChunk &chunk : qAsConst(chunks)) {
+        const auto error = mGidMapper.decodeRawLayerData(tileLayer, chunk.data, chunk.bounds);
+        if (error != GidMapper::NoError) {
+            reportDecodeError(tileLayer, error);
+            return;
+        }
+    }
+}
 
+void MapReaderPrivate::reportDecodeError(const TileLayer &tileLayer,
+                                         GidMapper::DecodeError error)
+{
     switch (error) {
     case GidMapper::CorruptLayerData:
         xml.raiseError(tr("Corrupt layer data for layer '%1'").arg(tileLayer.name()));
@@ -879,37 +1034,83 @@ void MapReaderPrivate::decodeBinaryLayerData(TileLayer &tileLayer,
     }
 }
 
+/**
+ * Parses the unsigned number at \a pos in \a text, allowing surrounding
+ * whitespace. Advances \a pos up to the next separator or the end.
+ */
+static bool parseCSVTile(const QChar *&pos, const QChar *end, unsigned &gid)
+{
+    while (pos != end && pos->isSpace())
+        ++pos;
+
+    const QChar *start = pos;
+    quint64 value = 0;
+
+    while (pos != end && pos->unicode() >= '0' && pos->unicode() <= '9') {
+        value = value * 10 + (pos->unicode() - '0');
+        if (value > UINT_MAX)
+            return false;
+        ++pos;
+    }
+
+    if (pos == start)
+        return false;
+
+    while (pos != end && pos->isSpace())
+        ++pos;
+
+    if (pos != end && *pos != QLatin1Char(','))
+        return false;
+
+    gid = static_cast<unsigned>(value);
+    return true;
+}
+
 void MapReaderPrivate::decodeCSVLayerData(TileLayer &tileLayer,
                                           QStringRef text,
                                           QRect bounds)
 {
-    QString trimText = text.trimmed().toString();
-    QStringList tiles = trimText.split(QLatin1Char(','));
+    const QStringRef trimText = text.trimmed();
+    const QChar *pos = trimText.constData();
+    const QChar *end = pos + trimText.size();
 
-    int lengthCheck = bounds.width() * bounds.height();
+    const int lengthCheck = bounds.width() * bounds.height();
 
-    if (tiles.length() != lengthCheck) {
+    if (trimText.count(QLatin1Char(',')) + 1 != lengthCheck) {
         xml.raiseError(tr("Corrupt layer data for layer '%1'")
                        .arg(tileLayer.name()));
         return;
     }
 
-    int currentTile = 0;
+    // Cells are set one strip of chunk rows at a time
+    QVector<Cell> cells;
 
-    for (int y = bounds.top(); y <= bounds.bottom(); y++) {
-        for (int x = bounds.left(); x <= bounds.right(); x++) {
-            bool conversionOk;
-            const unsigned gid = tiles.at(currentTile++).toUInt(&conversionOk);
+    for (int stripY = bounds.top(); stripY <= bounds.bottom(); stripY += CHUNK_SIZE) {
+        const int stripHeight = std::min(CHUNK_SIZE, bounds.bottom() + 1 - stripY);
+        const QRect strip(bounds.left(), stripY, bounds.width(), stripHeight);
 
-            if (!conversionOk) {
-                xml.raiseError(
-                        tr("Unable to parse tile at (%1,%2) on layer '%3'")
-                               .arg(x + 1).arg(y + 1).arg(tileLayer.name()));
-                return;
-            }
+        cells.resize(strip.width() * strip.height());
+        Cell *cell = cells.data();
+
+        for (int y = strip.top(); y <= strip.bottom(); y++) {
+            for (int x = strip.left(); x <= strip.right(); x++) {
+                unsigned gid;
+
+                if (!parseCSVTile(pos, end, gid)) {
+                    xml.raiseError(
+                            tr("Unable to parse tile at (%1,%2) on layer '%3'")
+                                   .arg(x + 1).arg(y + 1).arg(tileLayer.name()));
+                    return;
+                }
+
+                if (pos != end)
+                    ++pos;  // skip the separator
 
-            tileLayer.setCell(x, y, cellForGid(gid));
+                *cell++ = cellForGid(gid);
+            }
         }
+
+        tileLayer.setCells(strip, cells.constData());
     }
 }
 
@@ -194,8 +194,8 @@ static bool hasOpenGLEngine(const QPainter *painter)
 
 CellRenderer::CellRenderer(QPainter *painter, const CellType cellType)
     : mPainter(painter)
-    , mTile(nullptr)
     , mIsOpenGL(hasOpenGLEngine(painter))
+    , mUseAtlas(!(mIsOpenGL && painter->testRenderHint(QPainter::SmoothPixmapTransform)))
     , mCellType(cellType)
 {
 }
@@ -204,9 +204,11 @@ CellRenderer::CellRenderer(QPainter *painter, const CellType cellType)
  * Renders a \a cell with the given \a origin at \a pos, taking into account
  * the flipping and tile offset.
  *
- * For performance reasons, the actual drawing is delayed until a different
- * kind of tile has to be drawn. For this reason it is necessary to call
- * flush when finished doing drawCell calls. This function is also called by
+ * For performance reasons, the actual drawing is delayed until a tile from
+ * a different image has to be drawn. Tiles cut from the same tileset image
+ * are drawn from their shared atlas image, so they can be drawn together.
+ * For this reason it is necessary to call flush when finished doing drawCell
+ * calls. This function is also called by
  * the destructor so usually an explicit call is not needed.
  */
 void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &size, Origin origin)
@@ -224,15 +226,18 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &si
         return;
     }
 
+    const QPixmap &image = mUseAtlas ? tile->atlasImage() : tile->image();
+    const QRect sourceRect = mUseAtlas ? tile->atlasRect() : image.rect();
+    const QSizeF imageSize = sourceRect.size();
+    if (imageSize.isEmpty())
+        return;
+
     // The USHRT_MAX limit is rather arbitrary but avoids a crash in
     // drawPixmapFragments for a large number of fragments.
-    if (mTile != tile || mFragments.size() == USHRT_MAX)
+    if (mPixmap.cacheKey() != image.cacheKey() || mFragments.size() == USHRT_MAX) {
         flush();
-
-    const QPixmap &image = tile->image();
-    const QSizeF imageSize = image.size();
-    if (imageSize.isEmpty())
-        return;
+        mPixmap = image;
+    }
 
     const QSizeF scale(size.width() / imageSize.width(), size.height() / imageSize.height());
     const QPoint offset = tile->offset();
@@ -244,8 +249,8 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &si
     QPainter::PixmapFragment fragment;
     fragment.x = pos.x() + (offset.x() * scale.width()) + sizeHalf.x();
     fragment.y = pos.y() + (offset.y() * scale.height()) + sizeHalf.y() - size.height();
-    fragment.sourceLeft = 0;
-    fragment.sourceTop = 0;
+    fragment.sourceLeft = sourceRect.x();
+    fragment.sourceTop = sourceRect.y();
     fragment.width = imageSize.width();
     fragment.height = imageSize.height();
     fragment.scaleX = flippedHorizontally ? -1 : 1;
@@ -282,7 +287,6 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &si
     fragment.scaleY = scale.height() * (flippedVertically ? -1 : 1);
 
     if (mIsOpenGL || (fragment.scaleX > 0 && fragment.scaleY > 0)) {
-        mTile = tile;
         mFragments.append(fragment);
         return;
     }
@@ -300,7 +304,7 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &si
 
     const QRectF target(fragment.width * -0.5, fragment.height * -0.5,
                         fragment.width, fragment.height);
-    const QRectF source(0, 0, fragment.width, fragment.height);
+    const QRectF source(sourceRect);
 
     mPainter->setTransform(transform);
     mPainter->drawPixmap(target, image, source);
@@ -312,13 +316,12 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &si
  */
 void CellRenderer::flush()
 {
-    if (!mTile)
+    if (mFragments.isEmpty())
         return;
 
     mPainter->drawPixmapFragments(mFragments.constData(),
                                   mFragments.size(),
-                                  mTile->image());
+                                  mPixmap);
 
-    mTile = nullptr;
     mFragments.resize(0);
 }
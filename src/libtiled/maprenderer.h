@@ -295,9 +295,10 @@ public:
 
 private:
     QPainter * const mPainter;
-    const Tile *mTile;
+    QPixmap mPixmap;
     QVector<QPainter::PixmapFragment> mFragments;
     const bool mIsOpenGL;
+    const bool mUseAtlas;   // Smooth scaling on OpenGL may bleed in neighboring tiles
     const CellType mCellType;
 };
 
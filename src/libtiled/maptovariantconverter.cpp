@@ -38,6 +38,9 @@
 
 using namespace Tiled;
 
+// Number of chunks of an infinite map that are encoded in parallel at once
+static const int ChunkBatchSize = 1024;
+
 static QString colorToString(const QColor &color)
 {
     if (color.alpha() != 255)
@@ -49,6 +52,7 @@ QVariant MapToVariantConverter::toVariant(const Map &map, const QDir &mapDir)
 {
     mMapDir = mapDir;
     mGidMapper.clear();
+    mCompressionLevel = map.compressionLevel();
 
     QVariantMap mapVariant;
 
@@ -62,6 +66,9 @@ QVariant MapToVariantConverter::toVariant(const Map &map, const QDir &mapDir)
     mapVariant[QLatin1String("tilewidth")] = map.tileWidth();
     mapVariant[QLatin1String("tileheight")] = map.tileHeight();
     mapVariant[QLatin1String("infinite")] = map.infinite();
+
+    if (map.compressionLevel() != -1)
+        mapVariant[QLatin1String("compressionlevel")] = map.compressionLevel();
     mapVariant[QLatin1String("nextlayerid")] = map.nextLayerId();
     mapVariant[QLatin1String("nextobjectid")] = map.nextObjectId();
 
@@ -91,7 +98,7 @@ QVariant MapToVariantConverter::toVariant(const Map &map, const QDir &mapDir)
     mapVariant[QLatin1String("tilesets")] = tilesetVariants;
 
     mapVariant[QLatin1String("layers")] = toVariant(map.layers(),
-                                                    map.layerDataFormat());
+                                                    map.layerDataFormatForWriting());
 
     return mapVariant;
 }
@@ -378,30 +385,51 @@ QVariant MapToVariantConverter::toVariant(const TileLayer &tileLayer,
     case Map::Base64:
     case Map::Base64Zlib:
     case Map::Base64Gzip:
+    case Map::Base64Zstandard:
         tileLayerVariant[QLatin1String("encoding")] = QLatin1String("base64");
 
         if (format == Map::Base64Zlib)
             tileLayerVariant[QLatin1String("compression")] = QLatin1String("zlib");
         else if (format == Map::Base64Gzip)
             tileLayerVariant[QLatin1String("compression")] = QLatin1String("gzip");
+        else if (format == Map::Base64Zstandard)
+            tileLayerVariant[QLatin1String("compression")] = QLatin1String("zstd");
 
         break;
     }
 
     if (tileLayer.map()->infinite()) {
-        QVariantList chunkVariants;
-
-        for (const QRect &rect : tileLayer.sortedChunksToWrite()) {
-            QVariantMap chunkVariant;
+        const QVector<QRect> chunks = tileLayer.sortedChunksToWrite();
+        const bool binary = format != Map::XML && format != Map::CSV;
 
-            chunkVariant[QLatin1String("x")] = rect.x();
-            chunkVariant[QLatin1String("y")] = rect.y();
-            chunkVariant[QLatin1String("width")] = rect.width();
-            chunkVariant[QLatin1String("height")] = rect.height();
-
-            addTileLayerData(chunkVariant, tileLayer, format, rect);
-
-            chunkVariants.append(chunkVariant);
+        QVariantList chunkVariants;
+        chunkVariants.reserve(chunks.size());
+
+        // Binary chunk data is encoded and compressed in parallel, one batch
+        // at a time to limit memory usage
+        for (int first = 0; first < chunks.size(); first += ChunkBatchSize) {
+            const QVector<QRect> batch = chunks.mid(first, ChunkBatchSize);
+            QVector<QByteArray> batchData;
+            if (binary)
+                batchData = mGidMapper.encodeLayerChunks(tileLayer, format, batch,
+                                                         mCompressionLevel);
+
+            for (int i = 0; i < batch.size(); ++i) {
+                const QRect &rect = batch.at(i);
+                QVariantMap chunkVariant;
+
+                chunkVariant[QLatin1String("x")] = rect.x();
+                chunkVariant[QLatin1String("y")] = rect.y();
+                chunkVariant[QLatin1String("width")] = rect.width();
+                chunkVariant[QLatin1String("height")] = rect.height();
+
+                if (binary)
+                    chunkVariant[QLatin1String("data")] = batchData.at(i);
+                else
+                    addTileLayerData(chunkVariant, tileLayer, format, rect);
+
+                chunkVariants.append(chunkVariant);
+            }
         }
 
         tileLayerVariant[QLatin1String("chunks")] = chunkVariants;
@@ -610,18 +638,27 @@ void MapToVariantConverter::addTileLayerData(QVariantMap &variant,
     switch (format) {
     case Map::XML:
     case Map::CSV: {
+        const QVector<unsigned> gids = mGidMapper.cellsToGids(tileLayer, bounds);
+
+        if (mCompactTileData) {
+            variant[QLatin1String("data")] = QVariant::fromValue(gids);
+            break;
+        }
+
         QVariantList tileVariants;
-        for (int y = bounds.top(); y <= bounds.bottom(); ++y)
-            for (int x = bounds.left(); x <= bounds.right(); ++x)
-                tileVariants << mGidMapper.cellToGid(tileLayer.cellAt(x, y));
+        tileVariants.reserve(gids.size());
+        for (const unsigned gid : gids)
+            tileVariants << gid;
 
         variant[QLatin1String("data")] = tileVariants;
         break;
     }
     case Map::Base64:
     case Map::Base64Zlib:
-    case Map::Base64Gzip: {
-        QByteArray layerData = mGidMapper.encodeLayerData(tileLayer, format, bounds);
+    case Map::Base64Gzip:
+    case Map::Base64Zstandard: {
+        QByteArray layerData = mGidMapper.encodeLayerData(tileLayer, format, bounds,
+                                                          mCompressionLevel);
         variant[QLatin1String("data")] = layerData;
         break;
     }
@@ -41,7 +41,18 @@ struct TextData;
 class TILEDSHARED_EXPORT MapToVariantConverter
 {
 public:
-    MapToVariantConverter() {}
+    MapToVariantConverter()
+        : mCompressionLevel(-1)
+        , mCompactTileData(false)
+    {}
+
+    /**
+     * Sets whether uncompressed tile layer data is stored as a single
+     * QVector<unsigned> instead of a QVariantList with a QVariant for each
+     * tile. This greatly reduces memory usage for large maps, but the
+     * resulting variant can only be written by JsonWriter.
+     */
+    void setCompactTileData(bool compact) { mCompactTileData = compact; }
 
     /**
      * Converts the given \a map to a QVariant. The \a mapDir is used to
@@ -81,6 +92,8 @@ private:
 
     QDir mMapDir;
     GidMapper mGidMapper;
+    int mCompressionLevel;
+    bool mCompactTileData;
 };
 
 } // namespace Tiled
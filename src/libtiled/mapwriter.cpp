@@ -61,6 +61,9 @@ static QString colorToString(const QColor &color)
     return color.name();
 }
 
+// Number of chunks of an infinite map that are encoded in parallel at once
+static const int ChunkBatchSize = 1024;
+
 namespace Tiled {
 namespace Internal {
 
@@ -84,6 +87,7 @@ public:
 
     QString mError;
     Map::LayerDataFormat mLayerDataFormat;
+    int mCompressionLevel;
     bool mDtdEnabled;
 
 private:
@@ -93,6 +97,7 @@ private:
     void writeLayers(QXmlStreamWriter &w, const QList<Layer *> &layers);
     void writeTileLayer(QXmlStreamWriter &w, const TileLayer &tileLayer);
     void writeTileLayerData(QXmlStreamWriter &w, const TileLayer &tileLayer, QRect bounds);
+    void writeBinaryLayerData(QXmlStreamWriter &w, const QByteArray &data);
     void writeLayerAttributes(QXmlStreamWriter &w, const Layer &layer);
     void writeObjectGroup(QXmlStreamWriter &w, const ObjectGroup &objectGroup);
     void writeObject(QXmlStreamWriter &w, const MapObject &mapObject);
@@ -113,6 +118,7 @@ private:
 
 MapWriterPrivate::MapWriterPrivate()
     : mLayerDataFormat(Map::Base64Zlib)
+    , mCompressionLevel(-1)
     , mDtdEnabled(false)
     , mUseAbsolutePaths(false)
 {
@@ -148,7 +154,8 @@ void MapWriterPrivate::writeMap(const Map *map, QIODevice *device,
 {
     mMapDir = QDir(path);
     mUseAbsolutePaths = path.isEmpty();
-    mLayerDataFormat = map->layerDataFormat();
+    mLayerDataFormat = map->layerDataFormatForWriting();
+    mCompressionLevel = map->compressionLevel();
 
     AutoFormattingWriter writer(device);
     writer.writeStartDocument();
@@ -225,6 +232,11 @@ void MapWriterPrivate::writeMap(QXmlStreamWriter &w, const Map &map)
     w.writeAttribute(QLatin1String("infinite"),
                      QString::number(map.infinite()));
 
+    if (map.compressionLevel() != -1) {
+        w.writeAttribute(QLatin1String("compressionlevel"),
+                         QString::number(map.compressionLevel()));
+    }
+
     if (map.orientation() == Map::Hexagonal) {
         w.writeAttribute(QLatin1String("hexsidelength"),
                          QString::number(map.hexSideLength()));
@@ -562,7 +574,8 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
 
     if (mLayerDataFormat == Map::Base64
             || mLayerDataFormat == Map::Base64Gzip
-            || mLayerDataFormat == Map::Base64Zlib) {
+            || mLayerDataFormat == Map::Base64Zlib
+            || mLayerDataFormat == Map::Base64Zstandard) {
 
         encoding = QLatin1String("base64");
 
@@ -570,6 +583,8 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
             compression = QLatin1String("gzip");
         else if (mLayerDataFormat == Map::Base64Zlib)
             compression = QLatin1String("zlib");
+        else if (mLayerDataFormat == Map::Base64Zstandard)
+            compression = QLatin1String("zstd");
 
     } else if (mLayerDataFormat == Map::CSV)
         encoding = QLatin1String("csv");
@@ -581,16 +596,37 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
         w.writeAttribute(QLatin1String("compression"), compression);
 
     if (tileLayer.map()->infinite()) {
-        for (const QRect &rect : tileLayer.sortedChunksToWrite()) {
-            w.writeStartElement(QLatin1String("chunk"));
-            w.writeAttribute(QLatin1String("x"), QString::number(rect.x()));
-            w.writeAttribute(QLatin1String("y"), QString::number(rect.y()));
-            w.writeAttribute(QLatin1String("width"), QString::number(rect.width()));
-            w.writeAttribute(QLatin1String("height"), QString::number(rect.height()));
+        const QVector<QRect> chunks = tileLayer.sortedChunksToWrite();
+        const bool binary = !encoding.isEmpty() && mLayerDataFormat != Map::CSV;
+
+        // Binary chunks are encoded in parallel, one batch at a time to
+        // limit memory usage, while they are written in order
+        for (int first = 0; first < chunks.size(); first += ChunkBatchSize) {
+            const QVector<QRect> batch = chunks.mid(first, ChunkBatchSize);
+            QVector<QByteArray> batchData;
+            if (binary) {
+                batchData = mGidMapper.encodeLayerChunks(tileLayer,
+                                                         mLayerDataFormat,
+                                                         batch,
+                                                         mCompressionLevel);
+            }
+
+            for (int i = 0; i < batch.size(); ++i) {
+                const QRect &rect = batch.at(i);
 
-            writeTileLayerData(w, tileLayer, rect);
+                w.writeStartElement(QLatin1String("chunk"));
+                w.writeAttribute(QLatin1String("x"), QString::number(rect.x()));
+                w.writeAttribute(QLatin1String("y"), QString::number(rect.y()));
+                w.writeAttribute(QLatin1String("width"), QString::number(rect.width()));
+                w.writeAttribute(QLatin1String("height"), QString::number(rect.height()));
 
-            w.writeEndElement(); // </chunk>
+                if (binary)
+                    writeBinaryLayerData(w, batchData.at(i));
+                else
+                    writeTileLayerData(w, tileLayer, rect);
+
+                w.writeEndElement(); // </chunk>
+            }
         }
     } else {
         writeTileLayerData(w, tileLayer,
@@ -606,22 +642,22 @@ void MapWriterPrivate::writeTileLayerData(QXmlStreamWriter &w,
                                           QRect bounds)
 {
     if (mLayerDataFormat == Map::XML) {
-        for (int y = bounds.top(); y <= bounds.bottom(); y++) {
-            for (int x = bounds.left(); x <= bounds.right(); x++) {
-                const unsigned gid = mGidMapper.cellToGid(tileLayer.cellAt(x, y));
-                w.writeStartElement(QLatin1String("tile"));
-                if (gid != 0)
-                    w.writeAttribute(QLatin1String("gid"), QString::number(gid));
-                w.writeEndElement();
-            }
+        const QVector<unsigned> gids = mGidMapper.cellsToGids(tileLayer, bounds);
+
+        for (const unsigned gid : gids) {
+            w.writeStartElement(QLatin1String("tile"));
+            if (gid != 0)
+                w.writeAttribute(QLatin1String("gid"), QString::number(gid));
+            w.writeEndElement();
         }
     } else if (mLayerDataFormat == Map::CSV) {
+        const QVector<unsigned> gids = mGidMapper.cellsToGids(tileLayer, bounds);
+        const unsigned *gid = gids.constData();
         QString chunkData;
 
         for (int y = bounds.top(); y <= bounds.bottom(); y++) {
             for (int x = bounds.left(); x <= bounds.right(); x++) {
-                const unsigned gid = mGidMapper.cellToGid(tileLayer.cellAt(x, y));
-                chunkData.append(QString::number(gid));
+                chunkData.append(QString::number(*gid++));
                 if (x != bounds.right() || y != bounds.bottom())
                     chunkData.append(QLatin1String(","));
             }
@@ -631,16 +667,21 @@ void MapWriterPrivate::writeTileLayerData(QXmlStreamWriter &w,
         w.writeCharacters(QLatin1String("\n"));
         w.writeCharacters(chunkData);
     } else {
-        QByteArray chunkData = mGidMapper.encodeLayerData(tileLayer,
-                                                          mLayerDataFormat,
-                                                          bounds);
-
-        w.writeCharacters(QLatin1String("\n   "));
-        w.writeCharacters(QString::fromLatin1(chunkData));
-        w.writeCharacters(QLatin1String("\n  "));
+        writeBinaryLayerData(w, mGidMapper.encodeLayerData(tileLayer,
+                                                           mLayerDataFormat,
+                                                           bounds,
+                                                           mCompressionLevel));
     }
 }
 
+void MapWriterPrivate::writeBinaryLayerData(QXmlStreamWriter &w,
+                                            const QByteArray &data)
+{
+    w.writeCharacters(QLatin1String("\n   "));
+    w.writeCharacters(QString::fromLatin1(data));
+    w.writeCharacters(QLatin1String("\n  "));
+}
+
 void MapWriterPrivate::writeLayerAttributes(QXmlStreamWriter &w,
                                             const Layer &layer)
 {
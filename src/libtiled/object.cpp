@@ -34,6 +34,10 @@
 namespace Tiled {
 
 ObjectTypes Object::mObjectTypes;
+QHash<QString, int> Object::mObjectTypeIndex;
+QHash<QString, int> Object::mCaseFoldedObjectTypeIndex;
+QHash<QString, Properties> Object::mObjectTypeProperties;
+int Object::mObjectTypesRevision;
 
 Object::~Object()
 {}
@@ -82,19 +86,67 @@ QVariant Object::inheritedProperty(const QString &name) const
     }
 
     if (!objectType.isEmpty()) {
-        for (const ObjectType &type : mObjectTypes) {
-            if (type.name == objectType)
-                if (type.defaultProperties.contains(name))
-                    return type.defaultProperties.value(name);
-        }
+        const Properties properties = objectTypeProperties(objectType);
+        if (properties.contains(name))
+            return properties.value(name);
     }
 
     return QVariant();
 }
 
+/**
+ * Sets the object types and builds the tables used to look them up by name.
+ */
 void Object::setObjectTypes(const ObjectTypes &objectTypes)
 {
     mObjectTypes = objectTypes;
+
+    mObjectTypeIndex.clear();
+    mCaseFoldedObjectTypeIndex.clear();
+    mObjectTypeProperties.clear();
+
+    // Iterate backwards, so that the first type wins when names are duplicated
+    for (int i = mObjectTypes.size() - 1; i >= 0; --i) {
+        const QString &name = mObjectTypes.at(i).name;
+        mObjectTypeIndex.insert(name, i);
+        mCaseFoldedObjectTypeIndex.insert(name.toCaseFolded(), i);
+    }
+
+    // Types sharing a name all contribute their properties, with the first
+    // type taking precedence
+    for (const ObjectType &type : objectTypes) {
+        Properties &properties = mObjectTypeProperties[type.name];
+        QMapIterator<QString,QVariant> it(type.defaultProperties);
+        while (it.hasNext()) {
+            it.next();
+            if (!properties.contains(it.key()))
+                properties.insert(it.key(), it.value());
+        }
+    }
+
+    ++mObjectTypesRevision;
+}
+
+/**
+ * Returns the index of the first object type with the given \a name, or -1
+ * if there is no such type.
+ */
+int Object::objectTypeIndex(const QString &name, Qt::CaseSensitivity cs)
+{
+    if (cs == Qt::CaseSensitive)
+        return mObjectTypeIndex.value(name, -1);
+
+    return mCaseFoldedObjectTypeIndex.value(name.toCaseFolded(), -1);
+}
+
+/**
+ * Returns the default properties of the object types with the given \a name.
+ * When several types use the same name, their properties are combined, with
+ * the first type taking precedence.
+ */
+Properties Object::objectTypeProperties(const QString &name)
+{
+    return mObjectTypeProperties.value(name);
 }
 
 } // namespace Tiled
@@ -31,6 +31,8 @@
 #include "properties.h"
 #include "objecttypes.h"
 
+#include <QHash>
+
 namespace Tiled {
 
 /**
@@ -130,11 +132,26 @@ public:
     static const ObjectTypes &objectTypes()
     { return mObjectTypes; }
 
+    static int objectTypeIndex(const QString &name,
+                               Qt::CaseSensitivity cs = Qt::CaseSensitive);
+    static Properties objectTypeProperties(const QString &name);
+
+    /**
+     * Returns a number that changes each time the object types are set.
+     * Can be used to invalidate cached object type lookups.
+     */
+    static int objectTypesRevision()
+    { return mObjectTypesRevision; }
+
 private:
     const TypeId mTypeId;
     Properties mProperties;
 
     static ObjectTypes mObjectTypes;
+    static QHash<QString, int> mObjectTypeIndex;
+    static QHash<QString, int> mCaseFoldedObjectTypeIndex;
+    static QHash<QString, Properties> mObjectTypeProperties;
+    static int mObjectTypesRevision;
 };
 
 
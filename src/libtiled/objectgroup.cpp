@@ -33,8 +33,12 @@
 #include "layer.h"
 #include "map.h"
 #include "mapobject.h"
+#include "qtcompat_p.h"
 #include "tile.h"
 
+#include <QTransform>
+
+#include <algorithm>
 #include <cmath>
 
 using namespace Tiled;
@@ -61,6 +65,9 @@ void ObjectGroup::addObject(MapObject *object)
     object->setObjectGroup(this);
     if (mMap && object->id() == 0)
         object->setId(mMap->takeNextObjectId());
+
+    if (mIndexValid)
+        insertIntoIndex(object, mIndexNextOrder++);
 }
 
 void ObjectGroup::insertObject(int index, MapObject *object)
@@ -69,6 +76,15 @@ void ObjectGroup::insertObject(int index, MapObject *object)
     object->setObjectGroup(this);
     if (mMap && object->id() == 0)
         object->setId(mMap->takeNextObjectId());
+
+    if (mIndexValid) {
+        // Appended objects can be indexed right away, but inserting in
+        // between changes the order of the objects
+        if (index >= mObjects.size() - 1)
+            insertIntoIndex(object, mIndexNextOrder++);
+        else
+            invalidateIndex();
+    }
 }
 
 int ObjectGroup::removeObject(MapObject *object)
@@ -78,6 +94,7 @@ int ObjectGroup::removeObject(MapObject *object)
 
     mObjects.removeAt(index);
     object->setObjectGroup(nullptr);
+    removeFromIndex(object);
     return index;
 }
 
@@ -85,6 +102,7 @@ void ObjectGroup::removeObjectAt(int index)
 {
     MapObject *object = mObjects.takeAt(index);
     object->setObjectGroup(nullptr);
+    removeFromIndex(object);
 }
 
 void ObjectGroup::moveObjects(int from, int to, int count)
@@ -107,6 +125,8 @@ void ObjectGroup::moveObjects(int from, int to, int count)
 
     for (int i = 0; i < count; ++i)
         mObjects.insert(to + i, movingObjects.at(i));
+
+    invalidateIndex();
 }
 
 QRectF ObjectGroup::objectsBoundingRect() const
@@ -153,6 +173,9 @@ void ObjectGroup::replaceReferencesToTileset(Tileset *oldTileset,
             object->setCell(cell);
         }
     }
+
+    // The size of the tiles may have changed
+    invalidateIndex();
 }
 
 void ObjectGroup::offsetObjects(const QPointF &offset,
@@ -183,6 +206,254 @@ void ObjectGroup::offsetObjects(const QPointF &offset,
 
         object->setPosition(object->position() + (newCenter - objectCenter));
     }
+
+    invalidateIndex();
+}
+
+// Groups with fewer objects are searched linearly, without building an index
+static const int MinIndexedObjects = 256;
+
+// Objects covering more grid cells than this are not stored on the grid
+static const int MaxIndexCellsPerObject = 64;
+
+static QRectF indexBounds(const MapObject *object)
+{
+    QRectF bounds = object->boundsUseTile().normalized();
+
+    // Tile objects are rendered scaled to the object size and displaced by
+    // the tile offset
+    if (const Tile *tile = object->cell().tile()) {
+        const QSizeF size = object->size();
+        QPointF offset = tile->offset();
+        if (!tile->size().isEmpty()) {
+            offset.rx() *= size.width() / tile->width();
+            offset.ry() *= size.height() / tile->height();
+        }
+
+        const QPointF &pos = object->position();
+        bounds |= QRectF(QPointF(pos.x(), pos.y() - size.height()) + offset,
+                         size).normalized();
+    }
+
+    switch (object->shape()) {
+    case MapObject::Polygon:
+    case MapObject::Polyline:
+        bounds |= object->polygon().boundingRect().translated(object->position());
+        break;
+    default:
+        break;
+    }
+
+    if (object->rotation() != 0.0) {
+        const QPointF &pos = object->position();
+        QTransform transform;
+        transform.translate(pos.x(), pos.y());
+        transform.rotate(object->rotation());
+        transform.translate(-pos.x(), -pos.y());
+        bounds |= transform.mapRect(bounds);
+    }
+
+    return bounds;
+}
+
+/*
+ * Like QRectF::intersects, but also true for rectangles that only touch and
+ * for empty rectangles, so that objects without a size are found as well.
+ */
+static bool touches(const QRectF &a, const QRectF &b)
+{
+    return a.left() <= b.right() && a.right() >= b.left() &&
+           a.top() <= b.bottom() && a.bottom() >= b.top();
+}
+
+/*
+ * Determines the grid cells covered by \a bounds. Returns false when there
+ * are more than \a maxCells of them, or when the coordinates are out of
+ * range.
+ */
+static bool gridCells(const QRectF &bounds, qreal cellSize, int maxCells, QRect &cells)
+{
+    const qreal left = std::floor(bounds.left() / cellSize);
+    const qreal top = std::floor(bounds.top() / cellSize);
+    const qreal right = std::floor(bounds.right() / cellSize);
+    const qreal bottom = std::floor(bounds.bottom() / cellSize);
+
+    // Written such that NaN coordinates are rejected as well
+    const qreal limit = 1e9;
+    if (!((right - left + 1) * (bottom - top + 1) <= maxCells &&
+          left > -limit && top > -limit && right < limit && bottom < limit))
+        return false;
+
+    cells.setCoords(static_cast<int>(left), static_cast<int>(top),
+                    static_cast<int>(right), static_cast<int>(bottom));
+    return true;
+}
+
+static qint64 gridKey(int x, int y)
+{
+    return static_cast<qint64>((static_cast<quint64>(static_cast<quint32>(x)) << 32) |
+                               static_cast<quint32>(y));
+}
+
+QList<MapObject*> ObjectGroup::objectsInRect(const QRectF &rect) const
+{
+    QList<MapObject*> result;
+
+    if (mObjects.size() < MinIndexedObjects) {
+        for (MapObject *object : mObjects)
+            if (touches(indexBounds(object), rect))
+                result.append(object);
+        return result;
+    }
+
+    if (!mIndexValid)
+        buildIndex();
+
+    QRect cells;
+    if (!gridCells(rect.normalized(), mIndexCellSize, mObjects.size(), cells)) {
+        // Looking up this many cells is slower than checking each object
+        for (MapObject *object : mObjects)
+            if (touches(mIndexEntries.value(object).bounds, rect))
+                result.append(object);
+        return result;
+    }
+
+    QVector<QPair<quint64, MapObject*>> found;
+
+    for (int y = cells.top(); y <= cells.bottom(); ++y) {
+        for (int x = cells.left(); x <= cells.right(); ++x) {
+            const auto it = mIndexGrid.constFind(gridKey(x, y));
+            if (it == mIndexGrid.constEnd())
+                continue;
+
+            for (MapObject *object : *it) {
+                const IndexEntry &entry = *mIndexEntries.constFind(object);
+
+                // Only report objects spanning multiple cells in the first
+                // cell they share with the query
+                if (x != qMax(entry.cells.left(), cells.left()) ||
+                        y != qMax(entry.cells.top(), cells.top()))
+                    continue;
+
+                if (touches(entry.bounds, rect))
+                    found.append(qMakePair(entry.order, object));
+            }
+        }
+    }
+
+    for (MapObject *object : mLargeObjects) {
+        const IndexEntry &entry = *mIndexEntries.constFind(object);
+        if (touches(entry.bounds, rect))
+            found.append(qMakePair(entry.order, object));
+    }
+
+    std::sort(found.begin(), found.end());
+
+    result.reserve(found.size());
+    for (const auto &pair : qAsConst(found))
+        result.append(pair.second);
+
+    return result;
+}
+
+QList<MapObject*> ObjectGroup::objectsAt(const QPointF &pos) const
+{
+    return objectsInRect(QRectF(pos, QSizeF(0, 0)));
+}
+
+void ObjectGroup::updateIndex(MapObject *object)
+{
+    if (!mIndexValid)
+        return;
+
+    const auto it = mIndexEntries.constFind(object);
+    if (it == mIndexEntries.constEnd())
+        return;
+
+    const quint64 order = it->order;
+    removeFromIndex(object);
+    insertIntoIndex(object, order);
+}
+
+void ObjectGroup::invalidateIndex()
+{
+    if (!mIndexValid)
+        return;
+
+    mIndexValid = false;
+    mIndexEntries.clear();
+    mIndexGrid.clear();
+    mLargeObjects.clear();
+}
+
+void ObjectGroup::buildIndex() const
+{
+    mIndexEntries.clear();
+    mIndexGrid.clear();
+    mLargeObjects.clear();
+    mIndexNextOrder = 0;
+
+    // Use grid cells of twice the average object size, so that most objects
+    // are stored in no more than four cells
+    qreal totalSize = 0;
+    for (const MapObject *object : mObjects) {
+        const QRectF bounds = indexBounds(object);
+        totalSize += qMax(bounds.width(), bounds.height());
+    }
+
+    mIndexCellSize = 16;
+    if (!mObjects.isEmpty())
+        mIndexCellSize = qMax(mIndexCellSize, 2 * totalSize / mObjects.size());
+
+    mIndexEntries.reserve(mObjects.size());
+    for (MapObject *object : mObjects)
+        insertIntoIndex(object, mIndexNextOrder++);
+
+    mIndexValid = true;
+}
+
+void ObjectGroup::insertIntoIndex(MapObject *object, quint64 order) const
+{
+    IndexEntry entry;
+    entry.bounds = indexBounds(object);
+    entry.order = order;
+
+    if (gridCells(entry.bounds, mIndexCellSize, MaxIndexCellsPerObject, entry.cells)) {
+        for (int y = entry.cells.top(); y <= entry.cells.bottom(); ++y)
+            for (int x = entry.cells.left(); x <= entry.cells.right(); ++x)
+                mIndexGrid[gridKey(x, y)].append(object);
+    } else {
+        entry.cells = QRect();
+        mLargeObjects.append(object);
+    }
+
+    mIndexEntries.insert(object, entry);
+}
+
+void ObjectGroup::removeFromIndex(MapObject *object) const
+{
+    const auto it = mIndexEntries.find(object);
+    if (it == mIndexEntries.end())
+        return;
+
+    const QRect cells = it->cells;
+    if (cells.isNull()) {
+        mLargeObjects.removeOne(object);
+    } else {
+        for (int y = cells.top(); y <= cells.bottom(); ++y) {
+            for (int x = cells.left(); x <= cells.right(); ++x) {
+                const auto cell = mIndexGrid.find(gridKey(x, y));
+                if (cell == mIndexGrid.end())
+                    continue;
+
+                cell->removeOne(object);
+                if (cell->isEmpty())
+                    mIndexGrid.erase(cell);
+            }
+        }
+    }
+
+    mIndexEntries.erase(it);
 }
 
 bool ObjectGroup::canMergeWith(Layer *other) const
@@ -35,8 +35,11 @@
 #include "layer.h"
 
 #include <QColor>
+#include <QHash>
 #include <QList>
 #include <QMetaType>
+#include <QRectF>
+#include <QVector>
 
 namespace Tiled {
 
@@ -157,6 +160,39 @@ public:
     void offsetObjects(const QPointF &offset, const QRectF &bounds,
                        bool wrapX, bool wrapY);
 
+    /**
+     * Returns the objects whose bounds overlap or touch the given \a rect,
+     * in the order in which they appear in this group.
+     *
+     * The bounds used are MapObject::boundsUseTile(), extended to include
+     * the polygon and the rotation of the object. Callers that care about
+     * the exact shape of the objects should check the returned objects.
+     *
+     * For groups with many objects, this uses a spatial index that is
+     * built on first use.
+     */
+    QList<MapObject*> objectsInRect(const QRectF &rect) const;
+
+    /**
+     * Returns the objects whose bounds contain the given \a pos, in the
+     * order in which they appear in this group.
+     *
+     * \sa objectsInRect()
+     */
+    QList<MapObject*> objectsAt(const QPointF &pos) const;
+
+    /**
+     * Updates the spatial index for the given \a object. Needs to be called
+     * after changing the position, size, shape, rotation or tile of an object
+     * in this group.
+     */
+    void updateIndex(MapObject *object);
+
+    /**
+     * Drops the spatial index. It will be rebuilt when it is needed again.
+     */
+    void invalidateIndex();
+
     bool canMergeWith(Layer *other) const override;
     Layer *mergedWith(Layer *other) const override;
 
@@ -181,9 +217,28 @@ protected:
     ObjectGroup *initializeClone(ObjectGroup *clone) const;
 
 private:
+    struct IndexEntry
+    {
+        QRectF bounds;
+        QRect cells;        // Null for objects stored in mLargeObjects
+        quint64 order;
+    };
+
+    void buildIndex() const;
+    void insertIntoIndex(MapObject *object, quint64 order) const;
+    void removeFromIndex(MapObject *object) const;
+
     QList<MapObject*> mObjects;
     QColor mColor;
     DrawOrder mDrawOrder;
+
+    // Spatial index, built on demand by objectsInRect()
+    mutable bool mIndexValid = false;
+    mutable qreal mIndexCellSize = 1;
+    mutable quint64 mIndexNextOrder = 0;
+    mutable QHash<MapObject*, IndexEntry> mIndexEntries;
+    mutable QHash<qint64, QVector<MapObject*>> mIndexGrid;
+    mutable QVector<MapObject*> mLargeObjects;
 };
 
 
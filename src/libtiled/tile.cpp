@@ -152,6 +152,8 @@ void Tile::setFrames(const QVector<Frame> &frames)
 {
     resetAnimation();
     mFrames = frames;
+
+    mTileset->updateAnimatedTile(this);
 }
 
 /**
@@ -204,6 +206,8 @@ Tile *Tile::clone(Tileset *tileset) const
     Tile *c = new Tile(mImage, mId, tileset);
     c->setProperties(properties());
 
+    c->mAtlas = mAtlas;
+    c->mAtlasRect = mAtlasRect;
     c->mImageSource = mImageSource;
     c->mTerrain = mTerrain;
     c->mProbability = mProbability;
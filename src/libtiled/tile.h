@@ -106,6 +106,10 @@ public:
     const QPixmap &image() const;
     void setImage(const QPixmap &image);
 
+    const QPixmap &atlasImage() const;
+    QRect atlasRect() const;
+    void setAtlas(const QPixmap &atlas, const QRect &rect);
+
     const Tile *currentFrameTile() const;
 
     const QUrl &imageSource() const;
@@ -151,6 +155,8 @@ private:
     int mId;
     Tileset *mTileset;
     QPixmap mImage;
+    QPixmap mAtlas;
+    QRect mAtlasRect;
     QUrl mImageSource;
     LoadingStatus mImageStatus;
     QString mType;
@@ -190,14 +196,46 @@ inline const QPixmap &Tile::image() const
 }
 
 /**
- * Sets the image of this tile.
+ * Sets the image of this tile. This also clears any atlas set for this tile.
  */
 inline void Tile::setImage(const QPixmap &image)
 {
     mImage = image;
+    mAtlas = QPixmap();
+    mAtlasRect = QRect();
     mImageStatus = image.isNull() ? LoadingError : LoadingReady;
 }
 
+/**
+ * Returns the pixmap to use when rendering this tile. For tiles cut from a
+ * tileset image, this is the whole tileset image, shared by all its tiles.
+ * Otherwise this is the image of the tile.
+ *
+ * \sa atlasRect()
+ */
+inline const QPixmap &Tile::atlasImage() const
+{
+    return mAtlas.isNull() ? mImage : mAtlas;
+}
+
+/**
+ * Returns the area of this tile within its atlasImage().
+ */
+inline QRect Tile::atlasRect() const
+{
+    return mAtlas.isNull() ? QRect(QPoint(), mImage.size()) : mAtlasRect;
+}
+
+/**
+ * Sets the \a atlas image this tile was cut from and the \a rect within that
+ * image that matches this tile's image. Should be called after setImage().
+ */
+inline void Tile::setAtlas(const QPixmap &atlas, const QRect &rect)
+{
+    mAtlas = atlas;
+    mAtlasRect = rect;
+}
+
 /**
  * Returns the URL of the external image that represents this tile.
  * When this tile doesn't refer to an external image, an empty URL is
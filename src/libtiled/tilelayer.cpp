@@ -36,6 +36,34 @@
 
 using namespace Tiled;
 
+static int lowestBit(quint32 bits)
+{
+    Q_ASSERT(bits);
+#if defined(Q_CC_GNU)
+    return __builtin_ctz(bits);
+#else
+    int index = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+static int highestBit(quint32 bits)
+{
+    Q_ASSERT(bits);
+#if defined(Q_CC_GNU)
+    return 31 - __builtin_clz(bits);
+#else
+    int index = 0;
+    while (bits >>= 1)
+        ++index;
+    return index;
+#endif
+}
+
 QRegion Chunk::region(std::function<bool (const Cell &)> condition) const
 {
     QRegion region;
@@ -58,29 +86,93 @@ QRegion Chunk::region(std::function<bool (const Cell &)> condition) const
     return region;
 }
 
-void Chunk::setCell(int x, int y, const Cell &cell)
+/**
+ * Returns the region of non-empty cells in this chunk.
+ *
+ * Consecutive rows with the same cells are merged, so for example a fully
+ * filled chunk results in a single rectangle.
+ */
+QRegion Chunk::region() const
 {
-    int index = x + y * CHUNK_SIZE;
+    QVector<QRect> rects;
+
+    for (int y = 0; y < CHUNK_SIZE; ) {
+        const RowMask row = mOccupied[y];
 
-    mGrid[index] = cell;
+        int height = 1;
+        while (y + height < CHUNK_SIZE && mOccupied[y + height] == row)
+            ++height;
+
+        RowMask bits = row;
+        while (bits) {
+            const int start = lowestBit(bits);
+            const int end = start + lowestBit(~(bits >> start));
+
+            rects.append(QRect(start, y, end - start, height));
+            bits &= ~((RowMask(1) << end) - 1);
+        }
+
+        y += height;
+    }
+
+    // The rectangles are sorted and banded as required by setRects
+    QRegion region;
+    if (!rects.isEmpty())
+        region.setRects(rects.constData(), rects.size());
+    return region;
 }
 
-bool Chunk::isEmpty() const
+/**
+ * Returns the bounding rectangle of the non-empty cells in this chunk, or
+ * a null rectangle when the chunk is empty.
+ */
+QRect Chunk::bounds() const
 {
+    RowMask columns = 0;
+    int top = -1;
+    int bottom = -1;
+
     for (int y = 0; y < CHUNK_SIZE; ++y) {
-        for (int x = 0; x < CHUNK_SIZE; ++x) {
-            if (!cellAt(x, y).isEmpty())
-                return false;
+        if (const RowMask row = mOccupied[y]) {
+            columns |= row;
+            if (top == -1)
+                top = y;
+            bottom = y;
         }
     }
 
+    if (!columns)
+        return QRect();
+
+    return QRect(QPoint(lowestBit(columns), top),
+                 QPoint(highestBit(columns), bottom));
+}
+
+void Chunk::setCell(int x, int y, const Cell &cell)
+{
+    int index = x + y * CHUNK_SIZE;
+
+    mGrid[index] = encode(index, cell);
+
+    if (isEmptyWord(mGrid.at(index)))
+        mOccupied[y] &= ~(RowMask(1) << x);
+    else
+        mOccupied[y] |= RowMask(1) << x;
+}
+
+bool Chunk::isEmpty() const
+{
+    for (RowMask row : mOccupied)
+        if (row)
+            return false;
+
     return true;
 }
 
 bool Chunk::hasCell(std::function<bool (const Cell &)> condition) const
 {
-    for (const Cell &cell : mGrid)
-        if (condition(cell))
+    for (int i = 0, i_end = mGrid.size(); i < i_end; ++i)
+        if (condition(cellAtIndex(i)))
             return true;
 
     return false;
@@ -88,18 +180,132 @@ bool Chunk::hasCell(std::function<bool (const Cell &)> condition) const
 
 void Chunk::removeReferencesToTileset(Tileset *tileset)
 {
+    const int slot = mTilesets.indexOf(tileset) + 1;
+    if (slot == 0)
+        return;
+
     for (int i = 0, i_end = mGrid.size(); i < i_end; ++i) {
-        if (mGrid.at(i).tileset() == tileset)
-            mGrid.replace(i, Cell());
+        const quint32 word = mGrid.at(i);
+        if (static_cast<int>((word & SlotMask) >> SlotShift) == slot) {
+            mGrid[i] = 0;
+            mLargeTileIds.remove(i);
+            mOccupied[i / CHUNK_SIZE] &= ~(RowMask(1) << (i & CHUNK_MASK));
+        }
     }
+
+    mTilesets[slot - 1] = nullptr;
 }
 
 void Chunk::replaceReferencesToTileset(Tileset *oldTileset, Tileset *newTileset)
 {
-    for (Cell &cell : mGrid) {
-        if (cell.tileset() == oldTileset)
-            cell.setTile(newTileset, cell.tileId());
+    const int oldSlot = mTilesets.indexOf(oldTileset) + 1;
+    if (oldSlot == 0 || oldTileset == newTileset)
+        return;
+
+    const int newSlot = mTilesets.indexOf(newTileset) + 1;
+    if (newSlot == 0) {
+        // Only the tileset table needs updating, since the cells refer to it
+        mTilesets[oldSlot - 1] = newTileset;
+        return;
+    }
+
+    // The new tileset already has a slot, so move the cells over to it, to
+    // avoid having two slots referring to the same tileset
+    for (quint32 &word : mGrid) {
+        if (static_cast<int>((word & SlotMask) >> SlotShift) == oldSlot) {
+            word &= ~quint32(SlotMask);
+            word |= static_cast<quint32>(newSlot) << SlotShift;
+        }
+    }
+
+    mTilesets[oldSlot - 1] = nullptr;
+}
+
+/**
+ * Packs the given \a cell, to be stored at \a index, into a 32-bit word.
+ * Tile IDs that do not fit in the word are stored on the side.
+ */
+quint32 Chunk::encode(int index, const Cell &cell)
+{
+    if (!mLargeTileIds.isEmpty())
+        mLargeTileIds.remove(index);
+
+    quint32 word = static_cast<quint32>(cell._flags) << FlagsShift;
+
+    if (cell._tileset) {
+        const int slot = slotForTileset(cell._tileset);
+        word |= static_cast<quint32>(slot) << SlotShift;
+
+        if (cell._tileId >= 0 && cell._tileId < LargeTileId) {
+            word |= static_cast<quint32>(cell._tileId);
+        } else {
+            word |= LargeTileId;
+            mLargeTileIds.insert(index, cell._tileId);
+        }
+    }
+
+    return word;
+}
+
+/**
+ * Returns the slot (index + 1) of the given \a tileset in the chunk-local
+ * tileset table, adding it when necessary.
+ */
+int Chunk::slotForTileset(Tileset *tileset)
+{
+    int freeIndex = -1;
+
+    for (int i = 0, i_end = mTilesets.size(); i < i_end; ++i) {
+        Tileset *t = mTilesets.at(i);
+        if (t == tileset)
+            return i + 1;
+        if (!t && freeIndex == -1)
+            freeIndex = i;
     }
+
+    if (freeIndex != -1) {
+        mTilesets[freeIndex] = tileset;
+        return freeIndex + 1;
+    }
+
+    // A chunk can't use more than CHUNK_SIZE * CHUNK_SIZE tilesets at the
+    // same time, so dropping the unused entries is guaranteed to make room.
+    if (mTilesets.size() == MaxSlots)
+        compactTilesets();
+
+    mTilesets.append(tileset);
+    return mTilesets.size();
+}
+
+/**
+ * Rebuilds the tileset table so that it only contains the tilesets that are
+ * still referenced by a cell.
+ */
+void Chunk::compactTilesets()
+{
+    QVector<Tileset*> tilesets;
+    QVector<int> slotMapping(mTilesets.size() + 1, 0);
+
+    for (quint32 &word : mGrid) {
+        if (isEmptyWord(word))
+            continue;
+
+        const int slot = static_cast<int>((word & SlotMask) >> SlotShift);
+        int &newSlot = slotMapping[slot];
+        if (newSlot == 0) {
+            Tileset *tileset = mTilesets.at(slot - 1);
+            newSlot = tilesets.indexOf(tileset) + 1;
+            if (newSlot == 0) {
+                tilesets.append(tileset);
+                newSlot = tilesets.size();
+            }
+        }
+
+        word = (word & ~static_cast<quint32>(SlotMask)) |
+                (static_cast<quint32>(newSlot) << SlotShift);
+    }
+
+    mTilesets.swap(tilesets);
 }
 
 TileLayer::TileLayer(const QString &name, int x, int y, int width, int height)
@@ -174,6 +380,59 @@ QRegion TileLayer::region(std::function<bool (const Cell &)> condition) const
     return region;
 }
 
+/**
+ * Calculates the region occupied by the tiles of this layer. Similar to
+ * Layer::bounds(), but leaves out the regions without tiles.
+ */
+QRegion TileLayer::region() const
+{
+    QRegion region;
+
+    QHashIterator<QPoint, Chunk> it(mChunks);
+    while (it.hasNext()) {
+        it.next();
+        region += it.value().region().translated(it.key().x() * CHUNK_SIZE + mX,
+                                                 it.key().y() * CHUNK_SIZE + mY);
+    }
+
+    return region;
+}
+
+/**
+ * Returns the bounding rectangle of region(), without computing the region.
+ */
+QRect TileLayer::filledBounds() const
+{
+    QRect bounds;
+
+    QHashIterator<QPoint, Chunk> it(mChunks);
+    while (it.hasNext()) {
+        it.next();
+        const QRect chunkBounds = it.value().bounds();
+        if (!chunkBounds.isNull())
+            bounds |= chunkBounds.translated(it.key().x() * CHUNK_SIZE + mX,
+                                             it.key().y() * CHUNK_SIZE + mY);
+    }
+
+    return bounds;
+}
+
+/**
+ * Sets the chunk containing the cell at the given coordinates to a copy of
+ * \a chunk. Chunks share their data, so this is cheap until either of them
+ * is changed.
+ */
+void TileLayer::setChunk(int x, int y, const Chunk &chunk)
+{
+    this->chunk(x, y) = chunk;
+
+    mBounds = mBounds.united(QRect(x - (x & CHUNK_MASK),
+                                   y - (y & CHUNK_MASK),
+                                   CHUNK_SIZE,
+                                   CHUNK_SIZE));
+    mUsedTilesetsDirty = true;
+}
+
 /**
  * Sets the cell at the given coordinates.
  */
@@ -265,6 +524,46 @@ void TileLayer::setCells(int x, int y, TileLayer *layer,
                 setCell(_x, _y, layer->cellAt(_x - x, _y - y));
 }
 
+void TileLayer::setCells(const QRect &area, const Cell *cells)
+{
+    const int startX = area.left() - (area.left() & CHUNK_MASK);
+    const int startY = area.top() - (area.top() & CHUNK_MASK);
+
+    for (int chunkY = startY; chunkY <= area.bottom(); chunkY += CHUNK_SIZE) {
+        for (int chunkX = startX; chunkX <= area.right(); chunkX += CHUNK_SIZE) {
+            const QRect chunkRect(chunkX, chunkY, CHUNK_SIZE, CHUNK_SIZE);
+            const QRect r = chunkRect & area;
+
+            auto cellInArea = [&] (int x, int y) -> const Cell & {
+                return cells[(y - area.top()) * area.width() + (x - area.left())];
+            };
+
+            if (!findChunk(chunkX, chunkY)) {
+                // Avoid allocating chunks that would remain empty
+                bool needed = false;
+                for (int y = r.top(); y <= r.bottom() && !needed; ++y) {
+                    for (int x = r.left(); x <= r.right() && !needed; ++x) {
+                        const Cell &cell = cellInArea(x, y);
+                        needed = cell != mEmptyCell || cell.checked();
+                    }
+                }
+                if (!needed)
+                    continue;
+
+                mBounds = mBounds.united(chunkRect);
+            }
+
+            Chunk &_chunk = chunk(chunkX, chunkY);
+
+            for (int y = r.top(); y <= r.bottom(); ++y)
+                for (int x = r.left(); x <= r.right(); ++x)
+                    _chunk.setCell(x & CHUNK_MASK, y & CHUNK_MASK, cellInArea(x, y));
+        }
+    }
+
+    mUsedTilesetsDirty = true;
+}
+
 /**
  * Sets the tiles in the given \a area to \a tile. Flipping flags are
  * preserved.
@@ -520,7 +819,7 @@ void TileLayer::rotateHexagonal(RotateDirection direction, Map *map)
     mHeight = newHeight;
     mChunks = newLayer->mChunks;
 
-    QRect filledRect = region().boundingRect();
+    QRect filledRect = filledBounds();
 
     if (staggerAxis == Map::StaggerY) {
         if (filledRect.y() & 1)
@@ -540,8 +839,8 @@ QSet<SharedTileset> TileLayer::usedTilesets() const
         QSet<SharedTileset> tilesets;
 
         for (const Chunk &chunk : mChunks) {
-            for (const Cell &cell : chunk)
-                if (const Tile *tile = cell.tile())
+            for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; ++i)
+                if (const Tile *tile = chunk.cellAtIndex(i).tile())
                     tilesets.insert(tile->sharedTileset());
         }
 
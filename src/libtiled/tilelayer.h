@@ -43,6 +43,7 @@
 #include <QString>
 #include <QVector>
 
+#include <array>
 #include <functional>
 
 inline uint qHash(const QPoint &key, uint seed = 0) Q_DECL_NOTHROW
@@ -110,6 +111,8 @@ public:
     bool refersTile(const Tile *tile) const;
 
 private:
+    friend class Chunk;
+
     enum Flags {
         FlippedHorizontally     = 0x01,
         FlippedVertically       = 0x02,
@@ -148,21 +151,45 @@ inline bool Cell::refersTile(const Tile *tile) const
     return _tileset == tile->tileset() && _tileId == tile->id();
 }
 
+/**
+ * Hashes the parts of a cell that are compared by Cell::operator==.
+ */
+inline uint qHash(const Cell &cell, uint seed = 0) Q_DECL_NOTHROW
+{
+    const uint flags = (cell.flippedHorizontally() ? 0x1 : 0) |
+            (cell.flippedVertically() ? 0x2 : 0) |
+            (cell.flippedAntiDiagonally() ? 0x4 : 0) |
+            (cell.rotatedHexagonal120() ? 0x8 : 0);
+
+    return ::qHash(cell.tileset(), seed) ^
+            ::qHash((static_cast<uint>(cell.tileId()) << 4) | flags, seed);
+}
+
 
 /**
  * A Chunk is a grid of cells of size CHUNK_SIZExCHUNK_SIZE.
+ *
+ * To keep memory usage low, the cells are stored packed into 32-bit words.
+ * Each word refers to its tileset through a small chunk-local tileset table,
+ * and Cell instances are decoded from these words on access.
+ *
+ * Next to the cells, a chunk keeps a bitmask of the non-empty cells, which
+ * allows answering region(), bounds() and isEmpty() without decoding cells.
  */
 class TILEDSHARED_EXPORT Chunk
 {
 public:
     Chunk() :
-        mGrid(CHUNK_SIZE * CHUNK_SIZE)
+        mGrid(CHUNK_SIZE * CHUNK_SIZE, 0),
+        mOccupied()
     {}
 
     QRegion region(std::function<bool (const Cell &)> condition) const;
+    QRegion region() const;
+    QRect bounds() const;
 
-    const Cell &cellAt(int x, int y) const;
-    const Cell &cellAt(const QPoint &point) const;
+    Cell cellAt(int x, int y) const;
+    Cell cellAt(const QPoint &point) const;
 
     void setCell(int x, int y, const Cell &cell);
 
@@ -174,21 +201,70 @@ public:
 
     void replaceReferencesToTileset(Tileset *oldTileset, Tileset *newTileset);
 
-    QVector<Cell>::iterator begin() { return mGrid.begin(); }
-    QVector<Cell>::iterator end() { return mGrid.end(); }
-    QVector<Cell>::const_iterator begin() const { return mGrid.begin(); }
-    QVector<Cell>::const_iterator end() const { return mGrid.end(); }
+    Cell cellAtIndex(int index) const;
 
 private:
-    QVector<Cell> mGrid;
+    /*
+     * Layout of a packed cell:
+     *
+     *   bits  0-17: tile ID (LargeTileId means it is stored in mLargeTileIds)
+     *   bits 18-26: tileset slot (0 means no tileset, so the cell is empty)
+     *   bits 27-31: cell flags
+     */
+    enum {
+        TileIdBits  = 18,
+        TileIdMask  = (1 << TileIdBits) - 1,
+        LargeTileId = TileIdMask,
+        SlotShift   = TileIdBits,
+        SlotBits    = 9,
+        SlotMask    = ((1 << SlotBits) - 1) << SlotShift,
+        MaxSlots    = (1 << SlotBits) - 1,
+        FlagsShift  = SlotShift + SlotBits
+    };
+
+    static bool isEmptyWord(quint32 word) { return (word & SlotMask) == 0; }
+
+    // One bit per cell in a row, set when the cell is not empty
+    typedef quint32 RowMask;
+    static_assert(CHUNK_SIZE < 32, "Rows of a chunk must fit in a RowMask");
+
+    friend class GidMapper;
+
+    quint32 encode(int index, const Cell &cell);
+    int slotForTileset(Tileset *tileset);
+    void compactTilesets();
+
+    QVector<quint32> mGrid;
+    QVector<Tileset*> mTilesets;
+    QHash<int, int> mLargeTileIds;
+    std::array<RowMask, CHUNK_SIZE> mOccupied;
 };
 
-inline const Cell &Chunk::cellAt(int x, int y) const
+inline Cell Chunk::cellAtIndex(int index) const
 {
-    return mGrid.at(x + y * CHUNK_SIZE);
+    const quint32 word = mGrid.at(index);
+
+    Cell cell;
+    cell._flags = static_cast<int>(word >> FlagsShift);
+
+    if (!isEmptyWord(word)) {
+        const int slot = static_cast<int>((word & SlotMask) >> SlotShift);
+        const int tileId = static_cast<int>(word & TileIdMask);
+
+        cell._tileset = mTilesets.at(slot - 1);
+        cell._tileId = tileId == LargeTileId ? mLargeTileIds.value(index)
+                                             : tileId;
+    }
+
+    return cell;
 }
 
-inline const Cell &Chunk::cellAt(const QPoint &point) const
+inline Cell Chunk::cellAt(int x, int y) const
+{
+    return cellAtIndex(x + y * CHUNK_SIZE);
+}
+
+inline Cell Chunk::cellAt(const QPoint &point) const
 {
     return cellAt(point.x(), point.y());
 }
@@ -203,72 +279,18 @@ inline const Cell &Chunk::cellAt(const QPoint &point) const
 class TILEDSHARED_EXPORT TileLayer : public Layer
 {
 public:
-    class iterator
-    {
-    public:
-        iterator(QHash<QPoint, Chunk>::iterator it, QHash<QPoint, Chunk>::iterator end)
-            : mChunkPointer(it)
-            , mChunkEndPointer(end)
-        {
-            if (it != end)
-                mCellPointer = it.value().begin();
-        }
-
-        iterator operator++(int)
-        {
-            iterator it = *this;
-            advance();
-            return it;
-        }
-
-        iterator &operator++()
-        {
-            advance();
-            return *this;
-        }
-
-        Cell &operator*() { return *mCellPointer; }
-
-        QVector<Cell>::iterator operator->() const { return mCellPointer; }
-
-        friend bool operator==(const iterator& lhs, const iterator& rhs)
-        {
-            if (lhs.mChunkPointer == lhs.mChunkEndPointer || rhs.mChunkPointer == rhs.mChunkEndPointer)
-                return lhs.mChunkPointer == rhs.mChunkPointer;
-            else
-                return lhs.mCellPointer == rhs.mCellPointer;
-        }
-
-        friend bool operator!=(const iterator& lhs, const iterator& rhs)
-        {
-            if (lhs.mChunkPointer == lhs.mChunkEndPointer || rhs.mChunkPointer == rhs.mChunkEndPointer)
-                return lhs.mChunkPointer != rhs.mChunkPointer;
-            else
-                return lhs.mCellPointer != rhs.mCellPointer;
-        }
-
-        Cell &value() const { return *mCellPointer; }
-
-        QPoint key() const;
-
-    private:
-        void advance();
-
-        QHash<QPoint, Chunk>::iterator mChunkPointer;
-        QHash<QPoint, Chunk>::iterator mChunkEndPointer;
-        QVector<Cell>::iterator mCellPointer;
-    };
-
+    /**
+     * Iterates over all cells in the allocated chunks of a tile layer. Since
+     * cells are stored packed, the iterator returns decoded copies.
+     */
     class const_iterator
     {
     public:
         const_iterator(QHash<QPoint, Chunk>::const_iterator it, QHash<QPoint, Chunk>::const_iterator end)
             : mChunkPointer(it)
             , mChunkEndPointer(end)
-        {
-            if (it != end)
-                mCellPointer = it.value().begin();
-        }
+            , mCellIndex(0)
+        {}
 
         const_iterator operator++(int)
         {
@@ -283,27 +305,22 @@ public:
             return *this;
         }
 
-        const Cell &operator*() { return *mCellPointer; }
-
-        QVector<Cell>::const_iterator operator->() const { return mCellPointer; }
+        Cell operator*() const { return value(); }
 
         friend bool operator==(const const_iterator& lhs, const const_iterator& rhs)
         {
             if (lhs.mChunkPointer == lhs.mChunkEndPointer || rhs.mChunkPointer == rhs.mChunkEndPointer)
                 return lhs.mChunkPointer == rhs.mChunkPointer;
             else
-                return lhs.mCellPointer == rhs.mCellPointer;
+                return lhs.mChunkPointer == rhs.mChunkPointer && lhs.mCellIndex == rhs.mCellIndex;
         }
 
         friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs)
         {
-            if (lhs.mChunkPointer == lhs.mChunkEndPointer || rhs.mChunkPointer == rhs.mChunkEndPointer)
-                return lhs.mChunkPointer != rhs.mChunkPointer;
-            else
-                return lhs.mCellPointer != rhs.mCellPointer;
+            return !(lhs == rhs);
         }
 
-        const Cell &value() const { return *mCellPointer; }
+        Cell value() const { return mChunkPointer.value().cellAtIndex(mCellIndex); }
 
         QPoint key() const;
 
@@ -312,7 +329,7 @@ public:
 
         QHash<QPoint, Chunk>::const_iterator mChunkPointer;
         QHash<QPoint, Chunk>::const_iterator mChunkEndPointer;
-        QVector<Cell>::const_iterator mCellPointer;
+        int mCellIndex;
     };
 
     /**
@@ -355,11 +372,19 @@ public:
 
     const Chunk *findChunk(int x, int y) const;
 
+    void setChunk(int x, int y, const Chunk &chunk);
+
+    /**
+     * Returns the allocated chunks, indexed by their chunk coordinates.
+     */
+    const QHash<QPoint, Chunk> &chunks() const { return mChunks; }
+
     QRegion region(std::function<bool (const Cell &)> condition) const;
     QRegion region() const;
+    QRect filledBounds() const;
 
-    const Cell &cellAt(int x, int y) const;
-    const Cell &cellAt(const QPoint &point) const;
+    Cell cellAt(int x, int y) const;
+    Cell cellAt(const QPoint &point) const;
 
     void setCell(int x, int y, const Cell &cell);
 
@@ -394,6 +419,16 @@ public:
     void setCells(int x, int y, TileLayer *tileLayer,
                   const QRegion &mask = QRegion());
 
+    /**
+     * Sets the cells in the given \a area to the given \a cells, which are
+     * expected to contain area.width() * area.height() cells, row by row.
+     *
+     * This is much faster than calling setCell() for each cell, since each
+     * affected chunk is looked up only once and the set of used tilesets is
+     * recomputed only when needed.
+     */
+    void setCells(const QRect &area, const Cell *cells);
+
     void setTiles(const QRegion &area, Tile *tile);
 
     /**
@@ -493,8 +528,6 @@ public:
 
     TileLayer *clone() const override;
 
-    iterator begin() { return iterator(mChunks.begin(), mChunks.end()); }
-    iterator end() { return iterator(mChunks.end(), mChunks.end()); }
     const_iterator begin() const { return const_iterator(mChunks.begin(), mChunks.end()); }
     const_iterator end() const { return const_iterator(mChunks.end(), mChunks.end()); }
 
@@ -513,44 +546,20 @@ private:
     mutable bool mUsedTilesetsDirty;
 };
 
-inline QPoint TileLayer::iterator::key() const
-{
-    QPoint chunkStart = mChunkPointer.key();
-
-    int index = mCellPointer - mChunkPointer.value().begin();
-    chunkStart += QPoint(index & CHUNK_MASK, index / CHUNK_SIZE);
-
-    return chunkStart;
-}
-
-inline void TileLayer::iterator::advance()
-{
-    if (mChunkPointer != mChunkEndPointer) {
-        if (++mCellPointer == mChunkPointer.value().end()) {
-            mChunkPointer++;
-            if (mChunkPointer != mChunkEndPointer)
-                mCellPointer = mChunkPointer.value().begin();
-        }
-    }
-}
-
 inline QPoint TileLayer::const_iterator::key() const
 {
-    QPoint chunkStart = mChunkPointer.key();
+    const QPoint chunkCoordinates = mChunkPointer.key();
 
-    int index = mCellPointer - mChunkPointer.value().begin();
-    chunkStart += QPoint(index & CHUNK_MASK, index / CHUNK_SIZE);
-
-    return chunkStart;
+    return QPoint(chunkCoordinates.x() * CHUNK_SIZE + (mCellIndex & CHUNK_MASK),
+                  chunkCoordinates.y() * CHUNK_SIZE + mCellIndex / CHUNK_SIZE);
 }
 
 inline void TileLayer::const_iterator::advance()
 {
     if (mChunkPointer != mChunkEndPointer) {
-        if (++mCellPointer == mChunkPointer.value().end()) {
+        if (++mCellIndex == CHUNK_SIZE * CHUNK_SIZE) {
             mChunkPointer++;
-            if (mChunkPointer != mChunkEndPointer)
-                mCellPointer = mChunkPointer.value().begin();
+            mCellIndex = 0;
         }
     }
 }
@@ -590,19 +599,10 @@ inline const Chunk* TileLayer::findChunk(int x, int y) const
 }
 
 /**
- * Calculates the region occupied by the tiles of this layer. Similar to
- * Layer::bounds(), but leaves out the regions without tiles.
- */
-inline QRegion TileLayer::region() const
-{
-    return region([] (const Cell &cell) { return !cell.isEmpty(); });
-}
-
-/**
- * Returns a read-only reference to the cell at the given coordinates. The
- * coordinates have to be within this layer.
+ * Returns the cell at the given coordinates. Coordinates outside of the
+ * allocated chunks return an empty cell.
  */
-inline const Cell &TileLayer::cellAt(int x, int y) const
+inline Cell TileLayer::cellAt(int x, int y) const
 {
     if (const Chunk *chunk = findChunk(x, y))
         return chunk->cellAt(x & CHUNK_MASK, y & CHUNK_MASK);
@@ -610,7 +610,7 @@ inline const Cell &TileLayer::cellAt(int x, int y) const
         return mEmptyCell;
 }
 
-inline const Cell &TileLayer::cellAt(const QPoint &point) const
+inline Cell TileLayer::cellAt(const QPoint &point) const
 {
     return cellAt(point.x(), point.y());
 }
@@ -131,7 +131,10 @@ Tile *Tileset::findOrCreateTile(int id)
         return tile;
 
     mNextTileId = std::max(mNextTileId, id + 1);
-    return mTiles[id] = new Tile(id, this);
+
+    Tile *tile = new Tile(id, this);
+    insertTile(tile);
+    return tile;
 }
 
 /**
@@ -209,6 +212,13 @@ bool Tileset::loadFromImage(const QImage &image, const QUrl &source)
 
     const int stopWidth = image.width() - tileSize.width();
     const int stopHeight = image.height() - tileSize.height();
+    const QColor &transparent = mImageReference.transparentColor;
+
+    QPixmap atlas = QPixmap::fromImage(image);
+    if (transparent.isValid()) {
+        const QImage mask = image.createMaskFromColor(transparent.rgb());
+        atlas.setMask(QBitmap::fromImage(mask));
+    }
 
     int tileNum = 0;
 
@@ -216,18 +226,19 @@ bool Tileset::loadFromImage(const QImage &image, const QUrl &source)
         for (int x = margin; x <= stopWidth; x += tileSize.width() + spacing) {
             const QImage tileImage = image.copy(x, y, tileSize.width(), tileSize.height());
             QPixmap tilePixmap = QPixmap::fromImage(tileImage);
-            const QColor &transparent = mImageReference.transparentColor;
 
             if (transparent.isValid()) {
                 const QImage mask = tileImage.createMaskFromColor(transparent.rgb());
                 tilePixmap.setMask(QBitmap::fromImage(mask));
             }
 
-            auto it = mTiles.find(tileNum);
-            if (it != mTiles.end())
-                it.value()->setImage(tilePixmap);
+            Tile *tile = mTiles.value(tileNum);
+            if (tile)
+                tile->setImage(tilePixmap);
             else
-                mTiles.insert(tileNum, new Tile(tilePixmap, tileNum, this));
+                insertTile(tile = new Tile(tilePixmap, tileNum, this));
+
+            tile->setAtlas(atlas, QRect(x, y, tileSize.width(), tileSize.height()));
 
             ++tileNum;
         }
@@ -298,13 +309,22 @@ bool Tileset::loadImage()
     }
 
     auto tiles = ImageCache::cutTiles(p);
+    const QPixmap atlas = ImageCache::loadAtlas(p);
+
+    // The tiles are cut in rows, from the top-left of the image
+    const int columns = qMax(1, columnCountForWidth(image.width()));
 
     for (int tileNum = 0; tileNum < tiles.size(); ++tileNum) {
-        auto it = mTiles.find(tileNum);
-        if (it != mTiles.end())
-            it.value()->setImage(tiles.at(tileNum));
+        Tile *tile = mTiles.value(tileNum);
+        if (tile)
+            tile->setImage(tiles.at(tileNum));
         else
-            mTiles.insert(tileNum, new Tile(tiles.at(tileNum), tileNum, this));
+            insertTile(tile = new Tile(tiles.at(tileNum), tileNum, this));
+
+        const QRect rect(mMargin + (tileNum % columns) * (mTileWidth + mTileSpacing),
+                         mMargin + (tileNum / columns) * (mTileHeight + mTileSpacing),
+                         mTileWidth, mTileHeight);
+        tile->setAtlas(atlas, rect);
     }
 
     QScopedPointer<QPixmap> blank;
@@ -674,7 +694,7 @@ Tile *Tileset::addTile(const QPixmap &image, const QUrl &source)
     newTile->setImage(image);
     newTile->setImageSource(source);
 
-    mTiles.insert(newTile->id(), newTile);
+    insertTile(newTile);
     if (mTileHeight < image.height())
         mTileHeight = image.height();
     if (mTileWidth < image.width())
@@ -691,7 +711,7 @@ void Tileset::addTiles(const QList<Tile *> &tiles)
 {
     for (Tile *tile : tiles) {
         Q_ASSERT(!mTiles.contains(tile->id()));
-        mTiles.insert(tile->id(), tile);
+        insertTile(tile);
     }
 
     updateTileSize();
@@ -706,7 +726,7 @@ void Tileset::removeTiles(const QList<Tile *> &tiles)
 {
     for (Tile *tile : tiles) {
         Q_ASSERT(mTiles.contains(tile->id()));
-        mTiles.remove(tile->id());
+        takeTile(tile->id());
     }
 
     updateTileSize();
@@ -717,7 +737,7 @@ void Tileset::removeTiles(const QList<Tile *> &tiles)
  */
 void Tileset::deleteTile(int id)
 {
-    delete mTiles.take(id);
+    delete takeTile(id);
 }
 
 /**
@@ -775,6 +795,8 @@ void Tileset::swap(Tileset &other)
     std::swap(mExpectedColumnCount, other.mExpectedColumnCount);
     std::swap(mExpectedRowCount, other.mExpectedRowCount);
     std::swap(mTiles, other.mTiles);
+    std::swap(mTileLookup, other.mTileLookup);
+    std::swap(mAnimatedTiles, other.mAnimatedTiles);
     std::swap(mNextTileId, other.mNextTileId);
     std::swap(mTerrainTypes, other.mTerrainTypes);
     std::swap(mWangSets, other.mWangSets);
@@ -820,15 +842,8 @@ SharedTileset Tileset::clone() const
     c->mBackgroundColor = mBackgroundColor;
     c->mFormat = mFormat;
 
-    QMapIterator<int, Tile*> tileIterator(mTiles);
-    while (tileIterator.hasNext()) {
-        tileIterator.next();
-
-        const int id = tileIterator.key();
-        const Tile *tile = tileIterator.value();
-
-        c->mTiles.insert(id, tile->clone(c.data()));
-    }
+    for (const Tile *tile : mTiles)
+        c->insertTile(tile->clone(c.data()));
 
     c->mTerrainTypes.reserve(mTerrainTypes.size());
     for (Terrain *terrain : mTerrainTypes)
@@ -859,6 +874,79 @@ void Tileset::updateTileSize()
     mTileHeight = maxHeight;
 }
 
+/**
+ * Adds the given \a tile to the tile map and the tile lookup table.
+ */
+void Tileset::insertTile(Tile *tile)
+{
+    const int id = tile->id();
+    mTiles.insert(id, tile);
+
+    if (tile->isAnimated())
+        mAnimatedTiles.append(tile);
+
+    if (id < 0)
+        return;
+
+    if (id < mTileLookup.size())
+        mTileLookup[id] = tile;
+    else
+        growTileLookup(id);
+}
+
+/**
+ * Removes the tile with the given \a id from the tile map and the tile lookup
+ * table, and returns it.
+ */
+Tile *Tileset::takeTile(int id)
+{
+    if (id >= 0 && id < mTileLookup.size())
+        mTileLookup[id] = nullptr;
+
+    Tile *tile = mTiles.take(id);
+    if (tile)
+        mAnimatedTiles.removeOne(tile);
+
+    return tile;
+}
+
+/**
+ * Keeps the list of animated tiles up to date when the frames of the given
+ * \a tile have changed.
+ */
+void Tileset::updateAnimatedTile(Tile *tile)
+{
+    if (mTiles.value(tile->id()) != tile)
+        return;
+
+    const bool listed = mAnimatedTiles.contains(tile);
+    if (tile->isAnimated() && !listed)
+        mAnimatedTiles.append(tile);
+    else if (!tile->isAnimated() && listed)
+        mAnimatedTiles.removeOne(tile);
+}
+
+/**
+ * Grows the tile lookup table so that it includes the given \a id, unless
+ * that would make the table too sparse. Tiles that are not covered by the
+ * table are still found through the tile map.
+ */
+void Tileset::growTileLookup(int id)
+{
+    const int limit = 2 * mTiles.size() + 64;
+    if (id >= limit)
+        return;
+
+    const int oldSize = mTileLookup.size();
+    const int newSize = std::min(limit, std::max(id + 1, oldSize * 2));
+    mTileLookup.resize(newSize);
+
+    for (auto it = mTiles.lowerBound(oldSize), end = mTiles.end();
+         it != end && it.key() < newSize; ++it) {
+        mTileLookup[it.key()] = it.value();
+    }
+}
+
 
 QString Tileset::orientationToString(Tileset::Orientation orientation)
 {
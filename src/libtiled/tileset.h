@@ -133,6 +133,7 @@ public:
     void setGridSize(QSize gridSize);
 
     const QMap<int, Tile*> &tiles() const;
+    const QList<Tile*> &animatedTiles() const;
     inline Tile *findTile(int id) const;
     Tile *tileAt(int id) const { return findTile(id); } // provided for Python
     Tile *findOrCreateTile(int id);
@@ -237,6 +238,13 @@ private:
     void updateTileSize();
     void recalculateTerrainDistances();
 
+    void insertTile(Tile *tile);
+    Tile *takeTile(int id);
+    void growTileLookup(int id);
+
+    friend class Tile;
+    void updateAnimatedTile(Tile *tile);
+
     QString mName;
     QString mFileName;
     ImageReference mImageReference;
@@ -253,6 +261,8 @@ private:
     int mNextTileId;
     int mMaximumTerrainDistance;
     QMap<int, Tile*> mTiles;
+    QVector<Tile*> mTileLookup;         // dense, indexed by tile ID
+    QList<Tile*> mAnimatedTiles;
     QList<Terrain*> mTerrainTypes;
     QList<WangSet*> mWangSets;
     bool mTerrainDistancesDirty;
@@ -403,12 +413,26 @@ inline const QMap<int, Tile *> &Tileset::tiles() const
     return mTiles;
 }
 
+/**
+ * Returns the tiles in this tileset that have animation frames. Used to
+ * advance tile animations without visiting all tiles.
+ */
+inline const QList<Tile *> &Tileset::animatedTiles() const
+{
+    return mAnimatedTiles;
+}
+
 /**
  * Returns the tile with the given tile ID. The tile IDs are local to this
  * tileset.
+ *
+ * Tiles are looked up in a dense table indexed by tile ID. Only tiles with
+ * IDs beyond the end of that table need to be found in the tile map.
  */
 inline Tile *Tileset::findTile(int id) const
 {
+    if (id >= 0 && id < mTileLookup.size())
+        return mTileLookup.at(id);
     return mTiles.value(id);
 }
 
@@ -240,33 +240,33 @@ void TilesetManager::fileChangedTimeout()
  */
 void TilesetManager::resetTileAnimations()
 {
-    // TODO: This could be more optimal by keeping track of the list of
-    // actually animated tiles
+    QList<Tile*> changedTiles;
 
     for (Tileset *tileset : qAsConst(mTilesets)) {
-        bool imageChanged = false;
+        for (Tile *tile : tileset->animatedTiles())
+            if (tile->resetAnimation())
+                changedTiles.append(tile);
 
-        for (Tile *tile : tileset->tiles())
-            imageChanged |= tile->resetAnimation();
-
-        if (imageChanged)
-            emit repaintTileset(tileset);
+        if (!changedTiles.isEmpty()) {
+            emit repaintTiles(tileset, changedTiles);
+            changedTiles.clear();
+        }
     }
 }
 
 void TilesetManager::advanceTileAnimations(int ms)
 {
-    // TODO: This could be more optimal by keeping track of the list of
-    // actually animated tiles
+    QList<Tile*> changedTiles;
 
     for (Tileset *tileset : qAsConst(mTilesets)) {
-        bool imageChanged = false;
+        for (Tile *tile : tileset->animatedTiles())
+            if (tile->advanceAnimation(ms))
+                changedTiles.append(tile);
 
-        for (Tile *tile : tileset->tiles())
-            imageChanged |= tile->advanceAnimation(ms);
-
-        if (imageChanged)
-            emit repaintTileset(tileset);
+        if (!changedTiles.isEmpty()) {
+            emit repaintTiles(tileset, changedTiles);
+            changedTiles.clear();
+        }
     }
 }
 
@@ -81,10 +81,10 @@ signals:
     void tilesetImagesChanged(Tileset *tileset);
 
     /**
-     * Emitted when any images of the tiles in the given \a tileset have
+     * Emitted when the images of the given \a tiles from \a tileset have
      * changed as a result of playing tile animations.
      */
-    void repaintTileset(Tileset *tileset);
+    void repaintTiles(Tileset *tileset, const QList<Tile*> &tiles);
 
 private slots:
     void fileChanged(const QString &path);
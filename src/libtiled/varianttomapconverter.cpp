@@ -21,6 +21,7 @@
 
 #include "varianttomapconverter.h"
 
+#include "compression.h"
 #include "grouplayer.h"
 #include "imagelayer.h"
 #include "map.h"
@@ -86,6 +87,11 @@ Map *VariantToMapConverter::toMap(const QVariant &variant,
     map->setStaggerAxis(staggerAxis);
     map->setStaggerIndex(staggerIndex);
     map->setRenderOrder(renderOrder);
+
+    const QVariant compressionLevel = variantMap[QLatin1String("compressionlevel")];
+    if (compressionLevel.isValid())
+        map->setCompressionLevel(compressionLevel.toInt());
+
     if (nextLayerId)
         map->setNextLayerId(nextLayerId);
     if (nextObjectId)
@@ -531,6 +537,9 @@ TileLayer *VariantToMapConverter::toTileLayer(const QVariantMap &variantMap)
             layerDataFormat = Map::Base64Gzip;
         } else if (compression == QLatin1String("zlib")) {
             layerDataFormat = Map::Base64Zlib;
+        } else if (compression == QLatin1String("zstd")
+                   && compressionSupported(Zstandard)) {
+            layerDataFormat = Map::Base64Zstandard;
         } else {
             mError = tr("Compression method '%1' not supported").arg(compression);
             return nullptr;
@@ -809,6 +818,30 @@ bool VariantToMapConverter::readTileLayerData(TileLayer &tileLayer,
     switch (layerDataFormat) {
     case Map::XML:
     case Map::CSV: {
+        // Compact tile data, as provided by the JSON plugin's map reader
+        if (dataVariant.userType() == qMetaTypeId<QVector<unsigned> >()) {
+            const QVector<unsigned> gids = dataVariant.value<QVector<unsigned> >();
+
+            if (gids.size() != bounds.width() * bounds.height()) {
+                mError = tr("Corrupt layer data for layer '%1'").arg(tileLayer.name());
+                return false;
+            }
+
+            // Cells are set one row at a time
+            QVector<Cell> cells(bounds.width());
+            const unsigned *gid = gids.constData();
+            bool ok;
+
+            for (int y = bounds.top(); y <= bounds.bottom(); ++y) {
+                for (Cell &cell : cells)
+                    cell = mGidMapper.gidToCell(*gid++, ok);
+
+                tileLayer.setCells(QRect(bounds.left(), y, bounds.width(), 1),
+                                   cells.constData());
+            }
+            break;
+        }
+
         const QVariantList dataVariantList = dataVariant.toList();
 
         if (dataVariantList.size() != bounds.width() * bounds.height()) {
@@ -843,7 +876,8 @@ bool VariantToMapConverter::readTileLayerData(TileLayer &tileLayer,
 
     case Map::Base64:
     case Map::Base64Zlib:
-    case Map::Base64Gzip: {
+    case Map::Base64Gzip:
+    case Map::Base64Zstandard: {
         const QByteArray data = dataVariant.toByteArray();
         GidMapper::DecodeError error = mGidMapper.decodeLayerData(tileLayer,
                                                                   data,
@@ -28,6 +28,8 @@
 
 #include "worldmanager.h"
 
+#include "qtcompat_p.h"
+
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
@@ -37,12 +39,17 @@
 
 #include <QDebug>
 
+#include <algorithm>
+#include <numeric>
+
 namespace Tiled {
 
 WorldManager *WorldManager::mInstance;
 
 WorldManager::WorldManager()
 {
+    QObject::connect(&mWatcher, &FileSystemWatcher::directoryChanged,
+                     [this] (const QString &path) { directoryChanged(path); });
 }
 
 WorldManager::~WorldManager()
@@ -125,16 +132,41 @@ void WorldManager::loadWorld(const QString &fileName)
 
     world->onlyShowAdjacentMaps = object.value(QLatin1String("onlyShowAdjacentMaps")).toBool();
 
+    for (const World::MapEntry &mapEntry : qAsConst(world->maps))
+        if (!mWorldForMap.contains(mapEntry.fileName))
+            mWorldForMap.insert(mapEntry.fileName, world.data());
+
+    // The maps matched by patterns change when files are added or removed
+    if (!world->patterns.isEmpty())
+        mWatcher.addPath(QFileInfo(world->fileName).path());
+
     mWorlds.insert(fileName, world.take());
 }
 
 void WorldManager::unloadWorld(const QString &fileName)
 {
-    delete mWorlds.take(fileName);
+    World *world = mWorlds.take(fileName);
+    if (!world)
+        return;
+
+    for (auto it = mWorldForMap.begin(); it != mWorldForMap.end(); ) {
+        if (it.value() == world)
+            it = mWorldForMap.erase(it);
+        else
+            ++it;
+    }
+
+    if (!world->patterns.isEmpty())
+        mWatcher.removePath(QFileInfo(world->fileName).path());
+
+    delete world;
 }
 
 const World *WorldManager::worldForMap(const QString &fileName) const
 {
+    if (const World *world = mWorldForMap.value(fileName))
+        return world;
+
     for (const World *world : mWorlds)
         if (world->containsMap(fileName))
             return world;
@@ -142,12 +174,32 @@ const World *WorldManager::worldForMap(const QString &fileName) const
     return nullptr;
 }
 
+void WorldManager::directoryChanged(const QString &path)
+{
+    for (World *world : qAsConst(mWorlds))
+        if (!world->patterns.isEmpty() && QFileInfo(world->fileName).path() == path)
+            world->invalidateIndex();
+}
+
+/**
+ * Returns the explicitly listed map entry for the given \a fileName, or
+ * nullptr if there is no such entry.
+ */
+const World::MapEntry *World::findMap(const QString &fileName) const
+{
+    updateIndex();
+
+    const auto it = mMapIndex.constFind(fileName);
+    if (it == mMapIndex.constEnd())
+        return nullptr;
+
+    return &maps.at(it.value());
+}
+
 bool World::containsMap(const QString &fileName) const
 {
-    for (const World::MapEntry &mapEntry : maps) {
-        if (mapEntry.fileName == fileName)
-            return true;
-    }
+    if (findMap(fileName))
+        return true;
 
     for (const World::Pattern &pattern : patterns) {
         QRegularExpressionMatch match = pattern.regexp.match(fileName);
@@ -160,10 +212,8 @@ bool World::containsMap(const QString &fileName) const
 
 QRect World::mapRect(const QString &fileName) const
 {
-    for (const World::MapEntry &mapEntry : maps) {
-        if (mapEntry.fileName == fileName)
-            return mapEntry.rect;
-    }
+    if (const MapEntry *mapEntry = findMap(fileName))
+        return mapEntry->rect;
 
     for (const World::Pattern &pattern : patterns) {
         QRegularExpressionMatch match = pattern.regexp.match(fileName);
@@ -182,6 +232,37 @@ QRect World::mapRect(const QString &fileName) const
 
 QVector<World::MapEntry> World::allMaps() const
 {
+    updateIndex();
+    return mAllMaps;
+}
+
+static int floorDiv(int value, int divisor)
+{
+    return value < 0 ? (value + 1) / divisor - 1 : value / divisor;
+}
+
+static qint64 gridKey(int x, int y)
+{
+    return static_cast<qint64>((static_cast<quint64>(static_cast<quint32>(x)) << 32) |
+                               static_cast<quint32>(y));
+}
+
+// Maps covering more grid cells than this are not stored on the grid
+static const int MaxGridCellsPerMap = 64;
+
+/**
+ * Rebuilds the index of this world, when it was invalidated.
+ */
+void World::updateIndex() const
+{
+    if (mIndexValid)
+        return;
+
+    mMapIndex.clear();
+    for (int i = 0; i < maps.size(); ++i)
+        if (!mMapIndex.contains(maps.at(i).fileName))
+            mMapIndex.insert(maps.at(i).fileName, i);
+
     QVector<World::MapEntry> all(maps);
 
     if (!patterns.isEmpty()) {
@@ -206,16 +287,89 @@ QVector<World::MapEntry> World::allMaps() const
         }
     }
 
-    return all;
+    mAllMaps = all;
+
+    // Use the average map size as grid size, so that most maps are stored
+    // in only a few cells
+    qint64 totalSize = 0;
+    for (const World::MapEntry &mapEntry : all)
+        totalSize += qMax(mapEntry.rect.width(), mapEntry.rect.height());
+    mGridSize = all.isEmpty() ? 1 : qMax(1, static_cast<int>(totalSize / all.size()));
+
+    mGrid.clear();
+    mLargeMaps.clear();
+
+    for (int i = 0; i < all.size(); ++i) {
+        const QRect &rect = all.at(i).rect;
+        if (rect.isEmpty())
+            continue;
+
+        const int left = floorDiv(rect.left(), mGridSize);
+        const int top = floorDiv(rect.top(), mGridSize);
+        const int right = floorDiv(rect.right(), mGridSize);
+        const int bottom = floorDiv(rect.bottom(), mGridSize);
+
+        if (qint64(right - left + 1) * (bottom - top + 1) > MaxGridCellsPerMap) {
+            mLargeMaps.append(i);
+            continue;
+        }
+
+        for (int y = top; y <= bottom; ++y)
+            for (int x = left; x <= right; ++x)
+                mGrid[gridKey(x, y)].append(i);
+    }
+
+    mIndexValid = true;
+}
+
+/**
+ * Invalidates the index of this world. Needs to be called when the list of
+ * maps or patterns changed, or when the files in the world's directory
+ * changed.
+ */
+void World::invalidateIndex()
+{
+    mIndexValid = false;
+    mMapIndex.clear();
+    mAllMaps.clear();
+    mGrid.clear();
+    mLargeMaps.clear();
 }
 
 QVector<World::MapEntry> World::mapsInRect(const QRect &rect) const
 {
-    const QVector<World::MapEntry> all(allMaps());
+    updateIndex();
 
     QVector<World::MapEntry> maps;
+    if (rect.isEmpty())
+        return maps;
+
+    const int left = floorDiv(rect.left(), mGridSize);
+    const int top = floorDiv(rect.top(), mGridSize);
+    const int right = floorDiv(rect.right(), mGridSize);
+    const int bottom = floorDiv(rect.bottom(), mGridSize);
+
+    QVector<int> candidates;
+
+    if (qint64(right - left + 1) * (bottom - top + 1) > mGrid.size()) {
+        // Querying a large area, checking all maps is faster
+        candidates.resize(mAllMaps.size());
+        std::iota(candidates.begin(), candidates.end(), 0);
+    } else {
+        for (int y = top; y <= bottom; ++y)
+            for (int x = left; x <= right; ++x)
+                candidates += mGrid.value(gridKey(x, y));
+
+        candidates += mLargeMaps;
+
+        // Return the maps in their original order, without duplicates
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                         candidates.end());
+    }
 
-    for (const World::MapEntry &mapEntry : all) {
+    for (int index : qAsConst(candidates)) {
+        const World::MapEntry &mapEntry = mAllMaps.at(index);
         if (mapEntry.rect.intersects(rect))
             maps.append(mapEntry);
     }
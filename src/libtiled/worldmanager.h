@@ -29,6 +29,7 @@
 #ifndef WORLDMANAGER_H
 #define WORLDMANAGER_H
 
+#include "filesystemwatcher.h"
 #include "tiled_global.h"
 
 #include <QHash>
@@ -67,6 +68,22 @@ struct TILEDSHARED_EXPORT World
     QVector<MapEntry> allMaps() const;
     QVector<MapEntry> mapsInRect(const QRect &rect) const;
     QVector<MapEntry> contextMaps(const QString &fileName) const;
+
+    void invalidateIndex();
+
+private:
+    const MapEntry *findMap(const QString &fileName) const;
+    void updateIndex() const;
+
+    // Lazily built index of the explicitly listed maps and of all maps
+    // including those matched by patterns. The maps are also indexed on a
+    // grid, for fast lookups by area.
+    mutable bool mIndexValid = false;
+    mutable QHash<QString, int> mMapIndex;
+    mutable QVector<MapEntry> mAllMaps;
+    mutable QHash<qint64, QVector<int>> mGrid;
+    mutable QVector<int> mLargeMaps;
+    mutable int mGridSize = 1;
 };
 
 class TILEDSHARED_EXPORT WorldManager
@@ -88,7 +105,11 @@ private:
     WorldManager();
     ~WorldManager();
 
+    void directoryChanged(const QString &path);
+
     QHash<QString, World*> mWorlds;
+    QHash<QString, World*> mWorldForMap;    // explicitly listed maps only
+    FileSystemWatcher mWatcher;
 
     static WorldManager *mInstance;
 };
@@ -3,8 +3,10 @@ include(../plugin.pri)
 DEFINES += JSON_LIBRARY
 
 SOURCES += jsonplugin.cpp \
+    jsonmapreader.cpp \
     qjsonparser/json.cpp
 
 HEADERS += jsonplugin.h \
     json_global.h \
+    jsonmapreader.h \
     qjsonparser/json.h
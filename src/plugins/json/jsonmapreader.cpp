@@ -0,0 +1,369 @@
+/*
+ * JSON Tiled Plugin
+ * Copyright 2018, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jsonmapreader.h"
+
+#include <QTextCodec>
+#include <QVector>
+
+namespace Json {
+
+JsonMapReader::JsonMapReader()
+    : mPos(nullptr)
+    , mEnd(nullptr)
+    , mLineNumber(1)
+{
+}
+
+/**
+ * Returns whether the given \a data is UTF-8 encoded, using the same
+ * detection as JsonReader.
+ */
+bool JsonMapReader::canParse(const QByteArray &data)
+{
+    if (QTextCodec *codec = QTextCodec::codecForUtfText(data, nullptr))
+        return codec->mibEnum() == 106;
+
+    return data.length() <= 3 || (data.at(0) != 0 && data.at(1) != 0);
+}
+
+/**
+ * Parses the given UTF-8 encoded JSON \a data. Returns whether parsing was
+ * successful. On success, the parsed value is available as result().
+ */
+bool JsonMapReader::parse(const QByteArray &data)
+{
+    mPos = data.constData();
+    mEnd = mPos + data.size();
+    mLineNumber = 1;
+    mResult = QVariant();
+    mError.clear();
+
+    // Skip the byte order mark
+    if (data.startsWith("\xEF\xBB\xBF"))
+        mPos += 3;
+
+    QVariant value;
+    if (!parseValue(value))
+        return false;
+
+    skipWhitespace();
+    if (mPos != mEnd)
+        return raiseError("Expected end of file");
+
+    mResult = value;
+    return true;
+}
+
+bool JsonMapReader::parseValue(QVariant &value, bool tileData)
+{
+    skipWhitespace();
+    if (mPos == mEnd)
+        return raiseError("Unexpected end of file");
+
+    const char c = *mPos;
+    if (c == '{')
+        return parseObject(value);
+    if (c == '[')
+        return parseArray(value, tileData);
+    if (c == '"') {
+        QString string;
+        if (!parseString(string))
+            return false;
+        value = string;
+        return true;
+    }
+    if (atNumber()) {
+        parseNumber(value);
+        return true;
+    }
+    if (c >= 'a' && c <= 'z')
+        return parseKeyword(value);
+
+    return raiseError("Unexpected character");
+}
+
+bool JsonMapReader::parseObject(QVariant &value)
+{
+    ++mPos; // skip {
+
+    QVariantMap map;
+
+    skipWhitespace();
+    if (mPos != mEnd && *mPos == '}') {
+        ++mPos;
+        value = map;
+        return true;
+    }
+
+    // Like JsonReader, accept a comma following the empty member list
+    if (mPos != mEnd && *mPos == ',')
+        ++mPos;
+
+    while (true) {
+        skipWhitespace();
+        if (mPos == mEnd || *mPos != '"')
+            return raiseError("Expected string");
+
+        QString key;
+        if (!parseString(key))
+            return false;
+
+        skipWhitespace();
+        if (mPos == mEnd || *mPos != ':')
+            return raiseError("Expected ':'");
+        ++mPos;
+
+        QVariant memberValue;
+        if (!parseValue(memberValue, key == QLatin1String("data")))
+            return false;
+
+        map.insert(key, memberValue);
+
+        skipWhitespace();
+        if (mPos == mEnd)
+            return raiseError("Unexpected end of file");
+        if (*mPos == '}')
+            break;
+        if (*mPos != ',')
+            return raiseError("Expected ',' or '}'");
+        ++mPos;
+    }
+
+    ++mPos; // skip }
+    value = map;
+    return true;
+}
+
+/**
+ * Parses an array. When \a tileData is true, integers are stored in a
+ * compact QVector<unsigned> for as long as no other values are encountered.
+ */
+bool JsonMapReader::parseArray(QVariant &value, bool tileData)
+{
+    ++mPos; // skip [
+
+    QVariantList list;
+    QVector<unsigned> gids;
+    bool compact = tileData;
+
+    auto expand = [&] {
+        compact = false;
+        list.reserve(gids.size());
+        for (unsigned gid : gids)
+            list.append(gid);
+        gids = QVector<unsigned>();
+    };
+
+    skipWhitespace();
+    if (mPos != mEnd && *mPos == ']') {
+        ++mPos;
+    } else {
+        // Like JsonReader, accept a comma following the empty value list
+        if (mPos != mEnd && *mPos == ',')
+            ++mPos;
+
+        while (true) {
+            skipWhitespace();
+
+            if (compact && mPos != mEnd && atNumber()) {
+                QVariant number;
+                parseNumber(number);
+
+                if (number.type() == QVariant::LongLong) {
+                    // Same truncation as QVariant::toUInt()
+                    gids.append(static_cast<unsigned>(number.toLongLong()));
+                } else {
+                    expand();
+                    list.append(number);
+                }
+            } else {
+                if (compact)
+                    expand();
+
+                QVariant element;
+                if (!parseValue(element))
+                    return false;
+                list.append(element);
+            }
+
+            skipWhitespace();
+            if (mPos == mEnd)
+                return raiseError("Unexpected end of file");
+            if (*mPos == ']')
+                break;
+            if (*mPos != ',')
+                return raiseError("Expected ',' or ']'");
+            ++mPos;
+        }
+
+        ++mPos; // skip ]
+    }
+
+    if (compact)
+        value = QVariant::fromValue(gids);
+    else
+        value = list;
+
+    return true;
+}
+
+/**
+ * Parses a string, handling escape sequences the same way as JsonReader.
+ */
+bool JsonMapReader::parseString(QString &string)
+{
+    ++mPos; // skip "
+
+    const char *runStart = mPos;
+
+    while (mPos != mEnd) {
+        const char c = *mPos;
+
+        if (c == '"') {
+            string += QString::fromUtf8(runStart, int(mPos - runStart));
+            ++mPos;
+            return true;
+        }
+
+        if (c != '\\') {
+            ++mPos;
+            continue;
+        }
+
+        string += QString::fromUtf8(runStart, int(mPos - runStart));
+        ++mPos; // skip backslash
+        if (mPos == mEnd)
+            break;
+
+        switch (*mPos) {
+        case '"': string += QLatin1Char('"'); ++mPos; break;
+        case '\\': string += QLatin1Char('\\'); ++mPos; break;
+        case '/': string += QLatin1Char('/'); ++mPos; break;
+        case 'b': string += QLatin1Char('\b'); ++mPos; break;
+        case 'f': string += QLatin1Char('\f'); ++mPos; break;
+        case 'n': string += QLatin1Char('\n'); ++mPos; break;
+        case 'r': string += QLatin1Char('\r'); ++mPos; break;
+        case 't': string += QLatin1Char('\t'); ++mPos; break;
+        case 'u':
+            if (mPos + 4 < mEnd - 1) {
+                const QByteArray hex(mPos + 1, 4);
+                string += QChar(hex.toUShort(nullptr, 16));
+                mPos += 5;
+            } else {
+                string += QLatin1Char('u');
+                ++mPos;
+            }
+            break;
+        default:
+            // Any other escaped character is taken literally, as part of
+            // the next run
+            break;
+        }
+
+        runStart = mPos;
+    }
+
+    return raiseError("Unterminated string");
+}
+
+/**
+ * Parses a number the same way as JsonReader. Numbers containing a '.', 'e'
+ * or 'E' are parsed as double, others as qlonglong.
+ */
+void JsonMapReader::parseNumber(QVariant &value)
+{
+    const char *start = mPos;
+    bool isDouble = false;
+    qlonglong sign = 1;
+
+    if (*mPos == '-') {
+        sign = -1;
+        ++mPos;
+    } else if (*mPos == '+') {
+        ++mPos;
+    }
+
+    qulonglong number = 0;
+    for (; mPos != mEnd; ++mPos) {
+        const char c = *mPos;
+        if (c == '+' || c == '-')
+            continue;
+        if (c == '.' || c == 'e' || c == 'E') {
+            isDouble = true;
+            continue;
+        }
+        if (c >= '0' && c <= '9') {
+            if (!isDouble)
+                number = number * 10 + static_cast<qulonglong>(c - '0');
+            continue;
+        }
+        break;
+    }
+
+    if (isDouble)
+        value = QByteArray::fromRawData(start, int(mPos - start)).toDouble();
+    else
+        value = static_cast<qlonglong>(number) * sign;
+}
+
+bool JsonMapReader::parseKeyword(QVariant &value)
+{
+    const char *start = mPos;
+    while (mPos != mEnd && *mPos >= 'a' && *mPos <= 'z')
+        ++mPos;
+
+    const QByteArray keyword = QByteArray::fromRawData(start, int(mPos - start));
+    if (keyword == "true")
+        value = true;
+    else if (keyword == "false")
+        value = false;
+    else if (keyword == "null")
+        value = QVariant();
+    else
+        return raiseError("Unknown keyword");
+
+    return true;
+}
+
+bool JsonMapReader::atNumber() const
+{
+    const char c = *mPos;
+    return c == '+' || c == '-' || (c >= '0' && c <= '9');
+}
+
+void JsonMapReader::skipWhitespace()
+{
+    for (; mPos != mEnd; ++mPos) {
+        const char c = *mPos;
+        if (c == '\n')
+            ++mLineNumber;
+        else if (c != ' ' && c != '\r' && c != '\t')
+            break;
+    }
+}
+
+bool JsonMapReader::raiseError(const char *message)
+{
+    mError = QString::fromLatin1("%1 at line %2").arg(QLatin1String(message)).arg(mLineNumber);
+    return false;
+}
+
+} // namespace Json
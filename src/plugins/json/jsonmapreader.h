@@ -0,0 +1,72 @@
+/*
+ * JSON Tiled Plugin
+ * Copyright 2018, Thorbjørn Lindeijer <thorbjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+
+namespace Json {
+
+/**
+ * A JSON reader specialized for reading map files.
+ *
+ * It parses UTF-8 encoded JSON directly, without first converting the
+ * entire file to a QString. Arrays of integers found under a "data" key are
+ * stored as a single QVector<unsigned>, instead of a QVariantList with a
+ * QVariant for each tile. VariantToMapConverter decodes those directly into
+ * cells.
+ *
+ * It accepts the same input as JsonReader. Use canParse() to check whether
+ * the data is UTF-8 encoded, and fall back to JsonReader otherwise.
+ */
+class JsonMapReader
+{
+public:
+    JsonMapReader();
+
+    static bool canParse(const QByteArray &data);
+
+    bool parse(const QByteArray &data);
+
+    QVariant result() const { return mResult; }
+    QString errorString() const { return mError; }
+
+private:
+    bool parseValue(QVariant &value, bool tileData = false);
+    bool parseObject(QVariant &value);
+    bool parseArray(QVariant &value, bool tileData);
+    bool parseString(QString &string);
+    void parseNumber(QVariant &value);
+    bool parseKeyword(QVariant &value);
+
+    bool atNumber() const;
+    void skipWhitespace();
+    bool raiseError(const char *message);
+
+    const char *mPos;
+    const char *mEnd;
+    int mLineNumber;
+    QVariant mResult;
+    QString mError;
+};
+
+} // namespace Json
@@ -21,6 +21,7 @@
 
 #include "jsonplugin.h"
 
+#include "jsonmapreader.h"
 #include "maptovariantconverter.h"
 #include "varianttomapconverter.h"
 #include "savefile.h"
@@ -57,7 +58,6 @@ Tiled::Map *JsonMapFormat::read(const QString &fileName)
         return nullptr;
     }
 
-    JsonReader reader;
     QByteArray contents = file.readAll();
     if (mSubFormat == JavaScript && contents.size() > 0 && contents[0] != '{') {
         // Scan past JSONP prefix; look for an open curly at the start of the line
@@ -69,9 +69,19 @@ Tiled::Map *JsonMapFormat::read(const QString &fileName)
             if (contents.endsWith(')')) contents.chop(1);
         }
     }
-    reader.parse(contents);
 
-    const QVariant variant = reader.result();
+    QVariant variant;
+
+    // UTF-8 files are parsed directly, keeping tile layer data compact
+    if (JsonMapReader::canParse(contents)) {
+        JsonMapReader reader;
+        reader.parse(contents);
+        variant = reader.result();
+    } else {
+        JsonReader reader;
+        reader.parse(contents);
+        variant = reader.result();
+    }
 
     if (!variant.isValid()) {
         mError = tr("Error parsing file.");
@@ -96,18 +106,15 @@ bool JsonMapFormat::write(const Tiled::Map *map, const QString &fileName)
         return false;
     }
 
+    // Tile data is kept compact and the JSON is streamed to the file, to
+    // avoid a QVariant per tile and a copy of the entire output in memory
     Tiled::MapToVariantConverter converter;
+    converter.setCompactTileData(true);
     QVariant variant = converter.toVariant(*map, QFileInfo(fileName).dir());
 
     JsonWriter writer;
     writer.setAutoFormatting(true);
 
-    if (!writer.stringify(variant)) {
-        // This can only happen due to coding error
-        mError = writer.errorString();
-        return false;
-    }
-
     QTextStream out(file.device());
     if (mSubFormat == JavaScript) {
         // Trim and escape name
@@ -124,7 +131,11 @@ bool JsonMapFormat::write(const Tiled::Map *map, const QString &fileName)
         out << "  module.exports = data;\n";
         out << " }})(" << nameWriter.result() << ",\n";
     }
-    out << writer.result();
+    if (!writer.stringify(variant, out)) {
+        // This can only happen due to coding error
+        mError = writer.errorString();
+        return false;
+    }
     if (mSubFormat == JavaScript) {
         out << ");";
     }
@@ -11,6 +11,8 @@
 #include "jsonparser.cpp"
 
 #include <QTextCodec>
+#include <QTextStream>
+#include <QVector>
 #include <qnumeric.h>
 
 /*!
@@ -198,7 +200,7 @@ QString JsonReader::errorString() const
   Creates a JsonWriter.
  */
 JsonWriter::JsonWriter()
-    : m_autoFormatting(false), m_autoFormattingIndent(4, QLatin1Char(' '))
+    : m_stream(nullptr), m_autoFormatting(false), m_autoFormattingIndent(4, QLatin1Char(' '))
 {
 }
 
@@ -308,6 +310,21 @@ void JsonWriter::stringify(const QVariant &variant, int depth)
                     m_result += QLatin1Char(' ');
             }
             stringify(list[i], depth+1);
+            flush();
+        }
+        m_result += QLatin1Char(']');
+    } else if (variant.userType() == qMetaTypeId<QVector<unsigned> >()) {
+        // Compact alternative to a list of unsigned integers
+        const QVector<unsigned> numbers = variant.value<QVector<unsigned> >();
+        m_result += QLatin1Char('[');
+        for (int i = 0; i < numbers.size(); i++) {
+            if (i != 0) {
+                m_result += QLatin1Char(',');
+                if (m_autoFormatting)
+                    m_result += QLatin1Char(' ');
+            }
+            m_result += QString::number(numbers.at(i));
+            flush();
         }
         m_result += QLatin1Char(']');
     } else if (variant.type() == QVariant::Map) {
@@ -330,6 +347,7 @@ void JsonWriter::stringify(const QVariant &variant, int depth)
                 m_result += indent + QLatin1Char(' ');
             m_result += QLatin1Char('\"') + escape(it.key()) + QLatin1String("\":");
             stringify(it.value(), depth+1);
+            flush();
         }
         if (m_autoFormatting) {
             m_result += QLatin1Char('\n');
@@ -407,6 +425,9 @@ void JsonWriter::stringify(const QVariant &variant, int depth)
   \row
   \o QVariant::Char
   \o JSON string. Non-ASCII characters are converted into the \uXXXX notation.
+  \row
+  \o QVector<unsigned>
+  \o JSON array of numbers
   \endtable
 
   As a fallback, the writer attempts to convert a type not listed above into a long long or a
@@ -423,6 +444,36 @@ bool JsonWriter::stringify(const QVariant &var)
     return m_errorString.isEmpty();
 }
 
+/*!
+  Converts the variant \a var into a JSON string, which is written to
+  \a stream while it is being produced.
+
+  This avoids holding the entire JSON string in memory. Afterwards, result()
+  returns an empty string.
+ */
+bool JsonWriter::stringify(const QVariant &var, QTextStream &stream)
+{
+    m_stream = &stream;
+    const bool ok = stringify(var);
+    flush(true);
+    m_stream = nullptr;
+    return ok;
+}
+
+/*! \internal
+  Writes the result produced so far to the stream, if set and when enough
+  output was collected or when \a force is \c true.
+ */
+void JsonWriter::flush(bool force)
+{
+    if (!m_stream)
+        return;
+    if (force || m_result.size() >= 64 * 1024) {
+        *m_stream << m_result;
+        m_result.clear();
+    }
+}
+
 /*!
   Returns the result of the last stringify() call.
 
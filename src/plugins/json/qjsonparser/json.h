@@ -12,6 +12,8 @@
 #include <QByteArray>
 #include <QVariant>
 
+class QTextStream;
+
 class JsonReader
 {
 public:
@@ -37,6 +39,7 @@ public:
     ~JsonWriter();
 
     bool stringify(const QVariant &variant);
+    bool stringify(const QVariant &variant, QTextStream &stream);
 
     QString result() const;
 
@@ -50,7 +53,9 @@ public:
 
 private:
     void stringify(const QVariant &variant, int depth);
+    void flush(bool force = false);
 
+    QTextStream *m_stream;
     QString m_result;
     QString m_errorString;
     bool m_autoFormatting;
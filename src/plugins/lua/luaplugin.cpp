@@ -203,6 +203,10 @@ void LuaWriter::writeMap(LuaTableWriter &writer, const Map *map)
     writer.writeKeyAndValue("height", map->height());
     writer.writeKeyAndValue("tilewidth", map->tileWidth());
     writer.writeKeyAndValue("tileheight", map->tileHeight());
+
+    if (map->compressionLevel() != -1)
+        writer.writeKeyAndValue("compressionlevel", map->compressionLevel());
+
     writer.writeKeyAndValue("nextlayerid", map->nextLayerId());
     writer.writeKeyAndValue("nextobjectid", map->nextObjectId());
 
@@ -233,7 +237,7 @@ void LuaWriter::writeMap(LuaTableWriter &writer, const Map *map)
     }
     writer.writeEndTable();
 
-    writeLayers(writer, map->layers(), map->layerDataFormat());
+    writeLayers(writer, map->layers(), map->layerDataFormatForWriting());
 
     writer.writeEndTable();
 }
@@ -459,13 +463,16 @@ void LuaWriter::writeTileLayer(LuaTableWriter &writer,
 
     case Map::Base64:
     case Map::Base64Zlib:
-    case Map::Base64Gzip: {
+    case Map::Base64Gzip:
+    case Map::Base64Zstandard: {
         writer.writeKeyAndValue("encoding", "base64");
 
         if (format == Map::Base64Zlib)
             writer.writeKeyAndValue("compression", "zlib");
         else if (format == Map::Base64Gzip)
             writer.writeKeyAndValue("compression", "gzip");
+        else if (format == Map::Base64Zstandard)
+            writer.writeKeyAndValue("compression", "zstd");
 
         break;
     }
@@ -503,22 +510,28 @@ void LuaWriter::writeTileLayerData(LuaTableWriter &writer,
 {
     switch (format) {
     case Map::XML:
-    case Map::CSV:
+    case Map::CSV: {
+        const QVector<unsigned> gids = mGidMapper.cellsToGids(*tileLayer, bounds);
+        const unsigned *gid = gids.constData();
+
         writer.writeStartTable("data");
         for (int y = bounds.top(); y <= bounds.bottom(); ++y) {
             if (y > bounds.top())
                 writer.prepareNewLine();
 
             for (int x = bounds.left(); x <= bounds.right(); ++x)
-                writer.writeValue(mGidMapper.cellToGid(tileLayer->cellAt(x, y)));
+                writer.writeValue(*gid++);
         }
         writer.writeEndTable();
         break;
+    }
 
     case Map::Base64:
     case Map::Base64Zlib:
-    case Map::Base64Gzip: {
-        QByteArray layerData = mGidMapper.encodeLayerData(*tileLayer, format, bounds);
+    case Map::Base64Gzip:
+    case Map::Base64Zstandard: {
+        QByteArray layerData = mGidMapper.encodeLayerData(*tileLayer, format, bounds,
+                                                          tileLayer->map()->compressionLevel());
         writer.writeKeyAndValue("data", layerData);
         break;
     }
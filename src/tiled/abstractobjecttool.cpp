@@ -25,6 +25,7 @@
 #include "documentmanager.h"
 #include "mapdocument.h"
 #include "map.h"
+#include "mapitem.h"
 #include "mapobject.h"
 #include "mapobjectitem.h"
 #include "maprenderer.h"
@@ -207,6 +208,12 @@ ObjectGroup *AbstractObjectTool::currentObjectGroup() const
 
 QList<MapObject*> AbstractObjectTool::mapObjectsAt(const QPointF &pos) const
 {
+    // When possible, use the spatial index, since objects may not all have
+    // an item when they are drawn in batches
+    MapItem *mapItem = mMapScene->mapItem(mapDocument());
+    if (mapItem && mapItem->canFindObjectsInRect())
+        return mapItem->objectsAt(pos);
+
     const QList<QGraphicsItem *> &items = mMapScene->items(pos);
 
     QList<MapObject*> objectList;
@@ -223,6 +230,12 @@ QList<MapObject*> AbstractObjectTool::mapObjectsAt(const QPointF &pos) const
 
 MapObject *AbstractObjectTool::topMostMapObjectAt(const QPointF &pos) const
 {
+    MapItem *mapItem = mMapScene->mapItem(mapDocument());
+    if (mapItem && mapItem->canFindObjectsInRect()) {
+        const QList<MapObject*> objects = mapItem->objectsAt(pos);
+        return objects.isEmpty() ? nullptr : objects.first();
+    }
+
     const QList<QGraphicsItem *> &items = mMapScene->items(pos);
 
     for (QGraphicsItem *item : items) {
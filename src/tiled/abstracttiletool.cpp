@@ -27,6 +27,7 @@
 #include "mapscene.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tilesetmanager.h"
 
 #include <QtMath>
 
@@ -47,6 +48,13 @@ AbstractTileTool::AbstractTileTool(const QString &name,
         mBrushItem = new BrushItem;
     mBrushItem->setVisible(false);
     mBrushItem->setZValue(10000);
+
+    // The brush may show animated tiles
+    connect(TilesetManager::instance(), &TilesetManager::repaintTiles,
+            this, [this] {
+        if (mBrushItem->isVisible())
+            mBrushItem->update();
+    });
 }
 
 AbstractTileTool::~AbstractTileTool()
@@ -33,10 +33,16 @@
 #include "maprenderer.h"
 #include "object.h"
 #include "objectgroup.h"
+#include "preferences.h"
 #include "tile.h"
 #include "tilelayer.h"
 
 #include <QDebug>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <set>
+#include <utility>
 
 #include "qtcompat_p.h"
 
@@ -62,6 +68,9 @@ AutoMapper::AutoMapper(MapDocument *workingDocument, Map *rules,
     , mDeleteTiles(false)
     , mAutoMappingRadius(0)
     , mNoOverlappingRules(false)
+    , mEmptySetLayer(QString(), 0, 0, 0, 0)
+    , mParallel(false)
+    , mOutputAffectsInput(true)
 {
     Q_ASSERT(mMapRules);
 
@@ -481,22 +490,177 @@ void AutoMapper::autoMap(QRegion *where)
     // This needs to be done, so you can rely on the order of the rules at all
     // locations
     QRegion ret;
+    mParallel = Preferences::instance()->automappingParallel();
+    setupRuleIndex(*where);
 #if QT_VERSION < 0x050800
     const auto rects = where->rects();
     for (const QRect &rect : rects) {
 #else
     for (const QRect &rect : *where) {
 #endif
-        for (int i = 0; i < mRulesInput.size(); ++i) {
-            // at the moment the parallel execution does not work yet
-            // TODO: make multithreading available!
-            // either by dividing the rules or the region to multiple threads
+        // The rules are applied one after the other, since each rule needs
+        // to see the output of the previous ones. When possible, applyRule
+        // matches each rule on multiple threads.
+        for (int i = 0; i < mRulesInput.size(); ++i)
             ret = ret.united(applyRule(i, rect));
-        }
     }
+    cleanRuleIndex();
     *where = where->united(ret);
 }
 
+void AutoMapper::setupRuleIndex(const QRegion &where)
+{
+    cleanRuleIndex();
+
+    for (const InputIndex &inputIndex : qAsConst(mInputRules)) {
+        ResolvedInputIndex resolvedIndex;
+
+        for (auto it = inputIndex.begin(), end = inputIndex.end(); it != end; ++it) {
+            const int i = mMapWork->indexOfLayer(it.key(), Layer::TileLayerType);
+
+            ResolvedInputConditions resolved;
+            resolved.setLayer = (i >= 0) ? mMapWork->layerAt(i)->asTileLayer() : &mEmptySetLayer;
+            resolved.conditions = &it.value();
+            resolvedIndex.append(resolved);
+        }
+
+        mResolvedInputRules.append(resolvedIndex);
+    }
+
+    // Check whether the output can affect where the rules match
+    mOutputAffectsInput = false;
+    for (const RuleOutput &translationTable : qAsConst(mLayerList)) {
+        for (auto it = translationTable.begin(), end = translationTable.end(); it != end; ++it) {
+            if (!it.key()->isTileLayer())
+                continue;
+
+            const Layer *dstLayer = mMapWork->layerAt(it.value());
+            for (const ResolvedInputIndex &resolvedIndex : qAsConst(mResolvedInputRules))
+                for (const ResolvedInputConditions &resolved : resolvedIndex)
+                    if (resolved.setLayer == dstLayer)
+                        mOutputAffectsInput = true;
+        }
+    }
+
+    // Rules can only match where their input region overlaps the area, so
+    // only the cells around the area need to be indexed.
+    QSize maxRuleSize;
+    for (const QRegion &ruleInputRegion : qAsConst(mRulesInput))
+        maxRuleSize = maxRuleSize.expandedTo(ruleInputRegion.boundingRect().size());
+
+    const QRect area = where.boundingRect().adjusted(-maxRuleSize.width(),
+                                                     -maxRuleSize.height(),
+                                                     2 * maxRuleSize.width(),
+                                                     2 * maxRuleSize.height());
+
+    for (const ResolvedInputIndex &resolvedIndex : qAsConst(mResolvedInputRules)) {
+        for (const ResolvedInputConditions &resolved : resolvedIndex) {
+            const TileLayer *setLayer = resolved.setLayer;
+            if (mCellPositions.contains(setLayer))
+                continue;
+
+            CellPositions &positions = mCellPositions[setLayer];
+            const QRect layerArea = area & setLayer->bounds().translated(-setLayer->position());
+
+            for (int y = layerArea.top(); y <= layerArea.bottom(); ++y) {
+                for (int x = layerArea.left(); x <= layerArea.right(); ++x) {
+                    const Cell cell = setLayer->cellAt(x, y);
+                    if (!cell.isEmpty())
+                        positions[cell].append(QPoint(x, y));
+                }
+            }
+        }
+    }
+
+    // Pick for each input index of each rule the position at which the set
+    // layer needs to have one of the fewest candidate cells.
+    mRuleAnchors.reserve(mRulesInput.size());
+
+    for (const QRegion &ruleInputRegion : qAsConst(mRulesInput)) {
+        RuleAnchors ruleAnchors;
+        ruleAnchors.complete = true;
+
+        for (const ResolvedInputIndex &resolvedIndex : qAsConst(mResolvedInputRules)) {
+            bool canMatch = true;
+            bool found = false;
+            int bestCount = 0;
+            RuleAnchor bestAnchor;
+
+            for (const ResolvedInputConditions &resolved : resolvedIndex) {
+                const InputConditions &conditions = *resolved.conditions;
+                if (conditions.listYes.isEmpty() && conditions.listNo.isEmpty()) {
+                    canMatch = false;   // see layerMatchesConditions
+                    break;
+                }
+
+                const CellPositions &positions = mCellPositions[resolved.setLayer];
+
+#if QT_VERSION < 0x050800
+                const auto rects = ruleInputRegion.rects();
+                for (const QRect &rect : rects) {
+#else
+                for (const QRect &rect : ruleInputRegion) {
+#endif
+                    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                        for (int x = rect.left(); x <= rect.right(); ++x) {
+                            QVector<Cell> cells;
+                            bool usable = true;
+
+                            for (const InputLayer &inputLayer : conditions.listYes) {
+                                const Cell yesCell = inputLayer.tileLayer->cellAt(x, y);
+                                if (inputLayer.strictEmpty || !yesCell.isEmpty()) {
+                                    // Empty cells are not indexed
+                                    if (yesCell.isEmpty()) {
+                                        usable = false;
+                                        break;
+                                    }
+                                    if (!cells.contains(yesCell))
+                                        cells.append(yesCell);
+                                }
+                            }
+
+                            if (!usable || cells.isEmpty())
+                                continue;
+
+                            int count = 0;
+                            for (const Cell &cell : qAsConst(cells))
+                                count += positions.value(cell).size();
+
+                            if (!found || count < bestCount) {
+                                found = true;
+                                bestCount = count;
+                                bestAnchor.setLayer = resolved.setLayer;
+                                bestAnchor.position = QPoint(x, y);
+                                bestAnchor.cells = cells;
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (!canMatch)
+                continue;
+
+            if (!found) {
+                ruleAnchors.complete = false;
+                ruleAnchors.anchors.clear();
+                break;
+            }
+
+            ruleAnchors.anchors.append(bestAnchor);
+        }
+
+        mRuleAnchors.append(ruleAnchors);
+    }
+}
+
+void AutoMapper::cleanRuleIndex()
+{
+    mResolvedInputRules.clear();
+    mCellPositions.clear();
+    mRuleAnchors.clear();
+}
+
 QRegion AutoMapper::computeSetLayersRegion() const
 {
     QRegion result;
@@ -666,6 +830,27 @@ static bool layerMatchesConditions(const TileLayer &setLayer,
     return true;
 }
 
+bool AutoMapper::anyInputIndexMatches(const QRegion &ruleInputRegion,
+                                      QPoint offset) const
+{
+    for (const ResolvedInputIndex &resolvedIndex : mResolvedInputRules) {
+        bool allLayerNamesMatch = true;
+
+        for (const ResolvedInputConditions &resolved : resolvedIndex) {
+            if (!layerMatchesConditions(*resolved.setLayer, *resolved.conditions,
+                                        ruleInputRegion, offset)) {
+                allLayerNamesMatch = false;
+                break;
+            }
+        }
+
+        if (allLayerNamesMatch)
+            return true;
+    }
+
+    return false;
+}
+
 QRect AutoMapper::applyRule(int ruleIndex, const QRect &where)
 {
     QRect ret;
@@ -694,78 +879,167 @@ QRect AutoMapper::applyRule(int ruleIndex, const QRect &where)
     if (mNoOverlappingRules)
         appliedRegions.resize(mMapWork->layerCount());
 
-    const TileLayer dummy(QString(), 0, 0, 0, 0);
+    const RuleAnchors &ruleAnchors = mRuleAnchors.at(ruleIndex);
 
-    for (int y = minY; y <= maxY; ++y)
-    for (int x = minX; x <= maxX; ++x) {
-        bool anyMatch = false;
+    // When the rule has anchors, these are the positions where it could still
+    // match, ordered by row and then by column like a full scan.
+    std::set<std::pair<int, int>> candidates;
 
-        for (const InputIndex &inputIndex : qAsConst(mInputRules)) {
-            bool allLayerNamesMatch = true;
+    auto addCandidate = [&] (const RuleAnchor &anchor, QPoint setLayerPosition) {
+        const QPoint offset = setLayerPosition - anchor.position;
+        if (offset.x() >= minX && offset.x() <= maxX &&
+                offset.y() >= minY && offset.y() <= maxY) {
+            candidates.insert(std::make_pair(offset.y(), offset.x()));
+        }
+    };
+
+    auto applyMatchAt = [&] (int x, int y) {
+        // choose by chance which group of rule_layers should be used:
+        const int r = qrand() % mLayerList.size();
+        const RuleOutput &translationTable = mLayerList.at(r);
+
+        if (mNoOverlappingRules) {
+            bool overlap = false;
+            const QList<Layer*> layers = translationTable.keys();
 
-            QMapIterator<QString, InputConditions> inputIndexIterator(inputIndex);
-            while (inputIndexIterator.hasNext()) {
-                inputIndexIterator.next();
+            // check if there are no overlaps within this rule.
+            QVector<QRegion> ruleRegionInLayer;
+            for (int i = 0; i < layers.size(); ++i) {
+                Layer *layer = layers.at(i);
 
-                const QString &name = inputIndexIterator.key();
-                const InputConditions &conditions = inputIndexIterator.value();
+                QRegion appliedPlace;
 
-                const int i = mMapWork->indexOfLayer(name, Layer::TileLayerType);
-                const TileLayer &setLayer = (i >= 0) ? *mMapWork->layerAt(i)->asTileLayer() : dummy;
+                if (TileLayer *tileLayer = layer->asTileLayer())
+                    appliedPlace = tileLayer->region();
+                else if (ObjectGroup *objectGroup = layer->asObjectGroup())
+                    appliedPlace = tileRegionOfObjectGroup(objectGroup);
+                else
+                    continue;
+
+                ruleRegionInLayer.append(appliedPlace.intersected(ruleOutputRegion));
 
-                if (!layerMatchesConditions(setLayer, conditions, ruleInputRegion, QPoint(x, y))) {
-                    allLayerNamesMatch = false;
+                if (appliedRegions.at(i).intersects(ruleRegionInLayer.at(i).translated(x, y))) {
+                    overlap = true;
                     break;
                 }
             }
 
-            if (allLayerNamesMatch) {
-                anyMatch = true;
-                break;
-            }
+            if (overlap)
+                return;
+
+            for (int i = 0; i < translationTable.size(); ++i)
+                appliedRegions[i] += ruleRegionInLayer.at(i).translated(x, y);
         }
 
-        if (anyMatch) {
-            // choose by chance which group of rule_layers should be used:
-            const int r = qrand() % mLayerList.size();
-            const RuleOutput &translationTable = mLayerList.at(r);
+        copyMapRegion(ruleOutputRegion, QPoint(x, y), translationTable);
+        ret = ret.united(rbr.translated(QPoint(x, y)));
 
-            if (mNoOverlappingRules) {
-                bool overlap = false;
-                const QList<Layer*> layers = translationTable.keys();
+        // Keep the cell index up to date with the new output, which may also
+        // create new candidate positions for this rule.
+        const QRegion outputRegion = ruleOutputRegion.translated(x, y);
 
-                // check if there are no overlaps within this rule.
-                QVector<QRegion> ruleRegionInLayer;
-                for (int i = 0; i < layers.size(); ++i) {
-                    Layer *layer = layers.at(i);
+        for (auto it = translationTable.begin(), end = translationTable.end(); it != end; ++it) {
+            if (!it.key()->isTileLayer())
+                continue;
 
-                    QRegion appliedPlace;
+            const TileLayer *dstLayer = mMapWork->layerAt(it.value())->asTileLayer();
+            auto positionsIt = mCellPositions.find(dstLayer);
+            if (positionsIt == mCellPositions.end())
+                continue;
 
-                    if (TileLayer *tileLayer = layer->asTileLayer())
-                        appliedPlace = tileLayer->region();
-                    else if (ObjectGroup *objectGroup = layer->asObjectGroup())
-                        appliedPlace = tileRegionOfObjectGroup(objectGroup);
-                    else
-                        continue;
+#if QT_VERSION < 0x050800
+            const auto rects = outputRegion.rects();
+            for (const QRect &rect : rects) {
+#else
+            for (const QRect &rect : outputRegion) {
+#endif
+                for (int outputY = rect.top(); outputY <= rect.bottom(); ++outputY) {
+                    for (int outputX = rect.left(); outputX <= rect.right(); ++outputX) {
+                        const QPoint position(outputX, outputY);
+                        const Cell cell = dstLayer->cellAt(position);
+                        if (cell.isEmpty())
+                            continue;
+
+                        positionsIt.value()[cell].append(position);
 
-                    ruleRegionInLayer.append(appliedPlace.intersected(ruleOutputRegion));
+                        if (!ruleAnchors.complete)
+                            continue;
 
-                    if (appliedRegions.at(i).intersects(ruleRegionInLayer.at(i).translated(x, y))) {
-                        overlap = true;
-                        break;
+                        for (const RuleAnchor &anchor : ruleAnchors.anchors)
+                            if (anchor.setLayer == dstLayer && anchor.cells.contains(cell))
+                                addCandidate(anchor, position);
                     }
                 }
+            }
+        }
 
-                if (overlap)
-                    continue;
+        // Positions that were already passed are not revisited, just like
+        // with a full scan.
+        candidates.erase(candidates.begin(),
+                         candidates.upper_bound(std::make_pair(y, x)));
+    };
+
+    auto applyRuleAt = [&] (int x, int y) {
+        if (anyInputIndexMatches(ruleInputRegion, QPoint(x, y)))
+            applyMatchAt(x, y);
+    };
+
+    if (ruleAnchors.complete) {
+        // Only check the positions where one of the anchors is present
+        for (const RuleAnchor &anchor : ruleAnchors.anchors) {
+            const CellPositions &positions = mCellPositions[anchor.setLayer];
+            for (const Cell &cell : anchor.cells)
+                for (const QPoint &position : positions.value(cell))
+                    addCandidate(anchor, position);
+        }
+    }
 
-                for (int i = 0; i < translationTable.size(); ++i)
-                    appliedRegions[i] += ruleRegionInLayer.at(i).translated(x, y);
-            }
+    if (mParallel && !mOutputAffectsInput) {
+        // Since the output can't affect where this rule matches, all
+        // positions can be checked up front. Matching only reads from the
+        // layers, so it is spread over multiple threads. The matches are
+        // then applied in order, so the result is the same as when matching
+        // one position at a time.
+        QVector<QPoint> positions;
+        if (ruleAnchors.complete) {
+            positions.reserve(static_cast<int>(candidates.size()));
+            for (const std::pair<int, int> &candidate : candidates)
+                positions.append(QPoint(candidate.second, candidate.first));
+            candidates.clear();
+        } else {
+            positions.reserve((maxX - minX + 1) * (maxY - minY + 1));
+            for (int y = minY; y <= maxY; ++y)
+                for (int x = minX; x <= maxX; ++x)
+                    positions.append(QPoint(x, y));
+        }
 
-            copyMapRegion(ruleOutputRegion, QPoint(x, y), translationTable);
-            ret = ret.united(rbr.translated(QPoint(x, y)));
+        QVector<bool> matches(positions.size(), false);
+        bool *matchData = matches.data();
+
+        // Split the positions into bands of consecutive rows
+        const int bandSize = qMax(256, positions.size() / (QThread::idealThreadCount() * 4) + 1);
+        QVector<QPair<int, int>> bands;
+        for (int begin = 0; begin < positions.size(); begin += bandSize)
+            bands.append(qMakePair(begin, qMin(begin + bandSize, positions.size())));
+
+        QtConcurrent::blockingMap(bands, [&] (const QPair<int, int> &band) {
+            for (int i = band.first; i < band.second; ++i)
+                matchData[i] = anyInputIndexMatches(ruleInputRegion, positions.at(i));
+        });
+
+        for (int i = 0; i < positions.size(); ++i)
+            if (matches.at(i))
+                applyMatchAt(positions.at(i).x(), positions.at(i).y());
+    } else if (ruleAnchors.complete) {
+        while (!candidates.empty()) {
+            const std::pair<int, int> candidate = *candidates.begin();
+            candidates.erase(candidates.begin());
+            applyRuleAt(candidate.second, candidate.first);
         }
+    } else {
+        for (int y = minY; y <= maxY; ++y)
+            for (int x = minX; x <= maxX; ++x)
+                applyRuleAt(x, y);
     }
 
     return ret;
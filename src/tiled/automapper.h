@@ -20,8 +20,10 @@
 
 #pragma once
 
+#include "tilelayer.h"
 #include "tileset.h"
 
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QRegion>
@@ -70,6 +72,43 @@ public:
     QString index;
 };
 
+/**
+ * The conditions for an input layer name, along with the matching tile layer
+ * in the working map.
+ */
+struct ResolvedInputConditions
+{
+    const TileLayer *setLayer;
+    const InputConditions *conditions;
+};
+
+typedef QVector<ResolvedInputConditions> ResolvedInputIndex;
+
+/**
+ * A position in the input region of a rule, along with the cells of which
+ * one needs to be present there on the set layer for an input index to match.
+ */
+struct RuleAnchor
+{
+    const TileLayer *setLayer;
+    QPoint position;
+    QVector<Cell> cells;
+};
+
+/**
+ * The anchors of a rule, one for each of its input indexes that can match.
+ * When no anchor is found for one of the input indexes, the anchors are not
+ * complete and the rule needs to be checked at every position.
+ */
+struct RuleAnchors
+{
+    bool complete;
+    QVector<RuleAnchor> anchors;
+};
+
+// Positions of the non-empty cells of a set layer, indexed by cell
+typedef QHash<Cell, QVector<QPoint>> CellPositions;
+
 
 /**
  * This class does all the work for the automapping feature.
@@ -229,6 +268,25 @@ private:
     void copyMapRegion(const QRegion &region, QPoint Offset,
                        const RuleOutput &LayerTranslation);
 
+    /**
+     * Resolves the input layer names to the layers in the working map and
+     * indexes the cells of these layers around \a where. Then picks for
+     * each rule the most selective anchor to look up its candidate positions.
+     */
+    void setupRuleIndex(const QRegion &where);
+
+    /**
+     * Cleans up the data structures filled by setupRuleIndex().
+     */
+    void cleanRuleIndex();
+
+    /**
+     * Returns whether any input index matches the working map, when
+     * \a ruleInputRegion is placed at \a offset.
+     */
+    bool anyInputIndexMatches(const QRegion &ruleInputRegion,
+                              QPoint offset) const;
+
     /**
      * This goes through all the positions of the mMapWork and checks if
      * there fits the rule given by the region in mMapRuleSet.
@@ -356,6 +414,41 @@ private:
      */
     bool mNoOverlappingRules;
 
+    /**
+     * The input rules, with the input layer names resolved to the layers
+     * in mMapWork. Set up by setupRuleIndex().
+     */
+    QVector<ResolvedInputIndex> mResolvedInputRules;
+
+    /**
+     * Positions of the cells of the set layers, used to find the positions
+     * where the anchors in mRuleAnchors are present.
+     */
+    QHash<const TileLayer*, CellPositions> mCellPositions;
+
+    /**
+     * The anchors for each rule, index matching mRulesInput.
+     */
+    QVector<RuleAnchors> mRuleAnchors;
+
+    /**
+     * Stands in for set layers that are missing in mMapWork.
+     */
+    TileLayer mEmptySetLayer;
+
+    /**
+     * Whether the positions where a rule matches may be determined using
+     * multiple threads. Set from the preferences by autoMap().
+     */
+    bool mParallel;
+
+    /**
+     * Whether any of the output layers is also used as a set layer, in which
+     * case a rule can affect its own matches and needs to be matched one
+     * position at a time. Set up by setupRuleIndex().
+     */
+    bool mOutputAffectsInput;
+
     QSet<QString> mTouchedTileLayers;
     QSet<QString> mTouchedObjectGroups;
 
@@ -80,7 +80,13 @@ const QList<MapObject*> objectsInRegion(const ObjectGroup *layer,
                                         const QRegion &where)
 {
     QList<MapObject*> ret;
-    for (MapObject *obj : layer->objects()) {
+
+    // Use the spatial index to find the candidates. The search area is grown
+    // by one pixel, since the bounds are aligned below.
+    const QRectF searchRect = QRectF(where.boundingRect()).adjusted(-1, -1, 1, 1);
+    const QList<MapObject*> candidates = layer->objectsInRect(searchRect);
+
+    for (MapObject *obj : candidates) {
         // TODO: we are checking bounds, which is only correct for rectangles and
         // tile objects. polygons and polylines are not covered correctly by this
         // erase method (we are in fact deleting too many objects)
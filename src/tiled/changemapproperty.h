@@ -43,7 +43,8 @@ public:
         Orientation,
         RenderOrder,
         BackgroundColor,
-        LayerDataFormat
+        LayerDataFormat,
+        CompressionLevel
     };
 
     /**
@@ -70,6 +70,16 @@ bool Document::isModified() const
     return !mUndoStack->isClean();
 }
 
+/**
+ * Returns whether the last command on the undo stack can be undone. Unlike
+ * QUndoStack::canUndo(), this returns false when the undo stack is at its
+ * undo floor, below which the commands were collapsed to save memory.
+ */
+bool Document::canUndo() const
+{
+    return mUndoStack->canUndo() && mUndoStack->index() > mUndoFloor;
+}
+
 void Document::setCurrentObject(Object *object)
 {
     if (object == mCurrentObject)
@@ -90,6 +90,9 @@ public:
     QUndoStack *undoStack() const;
     bool isModified() const;
 
+    int undoFloor() const { return mUndoFloor; }
+    bool canUndo() const;
+
     Object *currentObject() const { return mCurrentObject; }
     void setCurrentObject(Object *object);
 
@@ -149,6 +152,8 @@ protected:
 
     QString mLastExportFileName;
 
+    int mUndoFloor = 0;                 /**< Commands below were collapsed. */
+
 private:
     static QList<Document*> sDocumentInstances;
 };
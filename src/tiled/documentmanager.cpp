@@ -43,6 +43,7 @@
 #include "utils.h"
 #include "zoomable.h"
 
+#include <QAction>
 #include <QCoreApplication>
 #include <QDialogButtonBox>
 #include <QFileDialog>
@@ -209,6 +210,32 @@ void DocumentManager::restoreState()
         iterator.next().value()->restoreState();
 }
 
+/**
+ * Creates an undo action for the active undo stack, like
+ * QUndoGroup::createUndoAction(). The action is also disabled when the
+ * document can't be undone any further because its oldest commands were
+ * collapsed.
+ *
+ * @see Document::canUndo()
+ */
+QAction *DocumentManager::createUndoAction(QObject *parent, const QString &prefix) const
+{
+    QAction *action = mUndoGroup->createUndoAction(parent, prefix);
+
+    // Connected after the action's own connection, so this takes precedence
+    connect(mUndoGroup, &QUndoGroup::canUndoChanged, action, [this, action] {
+        const QUndoStack *stack = mUndoGroup->activeStack();
+        for (const DocumentPtr &document : mDocuments) {
+            if (document->undoStack() == stack) {
+                action->setEnabled(document->canUndo());
+                return;
+            }
+        }
+    });
+
+    return action;
+}
+
 /**
  * Returns the current map document, or 0 when there is none.
  */
@@ -30,6 +30,7 @@
 #include <QPointF>
 #include <QVector>
 
+class QAction;
 class QTabWidget;
 class QUndoGroup;
 class QStackedLayout;
@@ -79,6 +80,7 @@ public:
     void restoreState();
 
     QUndoGroup *undoGroup() const;
+    QAction *createUndoAction(QObject *parent, const QString &prefix) const;
 
     Document *currentDocument() const;
 
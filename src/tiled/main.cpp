@@ -21,6 +21,7 @@
  */
 
 #include "commandlineparser.h"
+#include "imagecache.h"
 #include "languagemanager.h"
 #include "mainwindow.h"
 #include "mapdocument.h"
@@ -34,12 +35,18 @@
 #include "tiledapplication.h"
 #include "tileset.h"
 #include "tmxmapformat.h"
+#include "utils.h"
 #include "winsparkleautoupdater.h"
 
 #include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QFileInfo>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QSet>
+#include <QtConcurrentRun>
 #include <QtPlugin>
 
 #ifdef Q_OS_WIN
@@ -68,6 +75,7 @@ public:
     bool showedVersion;
     bool disableOpenGL;
     bool exportMap;
+    bool exportMaps;
     bool exportTileset;
     bool newInstance;
 
@@ -76,6 +84,7 @@ private:
     void justQuit();
     void setDisableOpenGL();
     void setExportMap();
+    void setExportMaps();
     void setExportTileset();
     void showExportFormats();
     void startNewInstance();
@@ -143,6 +152,232 @@ inline T *findExportFormat(const QString *filter,
     return outputFormat;
 }
 
+/**
+ * Expands the sources given to --export-maps into a list of map files.
+ *
+ * A source can be a file name, a wildcard pattern matching files in a single
+ * directory (like "maps/*.tmx") or a list file prefixed with '@', which
+ * contains one source per line.
+ */
+QStringList expandMapSources(const QStringList &sources)
+{
+    QStringList files;
+
+    for (const QString &source : sources) {
+        if (source.startsWith(QLatin1Char('@'))) {
+            QFile listFile(source.mid(1));
+            if (!listFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                qWarning().noquote() << QCoreApplication::translate("Command line", "Failed to open list file %1").arg(listFile.fileName());
+                files.append(listFile.fileName());   // Reported as failure later
+                continue;
+            }
+
+            // Relative paths in a list file are relative to the list file
+            const QDir listDir = QFileInfo(listFile.fileName()).absoluteDir();
+
+            QStringList listed;
+            while (!listFile.atEnd()) {
+                const QString line = QString::fromUtf8(listFile.readLine()).trimmed();
+                if (!line.isEmpty() && !line.startsWith(QLatin1Char('#')))
+                    listed.append(line.startsWith(QLatin1Char('@')) ? line : listDir.filePath(line));
+            }
+
+            files.append(expandMapSources(listed));
+        } else if (source.contains(QLatin1Char('*')) ||
+                   source.contains(QLatin1Char('?')) ||
+                   source.contains(QLatin1Char('['))) {
+            const QFileInfo pattern(source);
+            const QDir dir = pattern.dir();
+            const QStringList names = dir.entryList(QStringList(pattern.fileName()),
+                                                    QDir::Files | QDir::Readable,
+                                                    QDir::Name);
+            if (names.isEmpty())
+                qWarning().noquote() << QCoreApplication::translate("Command line", "No files matching %1").arg(source);
+
+            for (const QString &name : names)
+                files.append(dir.filePath(name));
+        } else {
+            files.append(source);
+        }
+    }
+
+    return files;
+}
+
+/**
+ * Returns whether \a format is implemented by a script. Scripts are only
+ * ever run on the main thread.
+ */
+bool isScriptFormat(const MapFormat *format)
+{
+    return format && format->inherits("Python::PythonMapFormat");
+}
+
+/**
+ * Returns whether \a sourceFile can be read while \a outputFormat is writing
+ * on another thread. Formats are not reentrant, so this is only the case
+ * when the file is read by a different format instance.
+ */
+bool canReadWhileWriting(const QString &sourceFile, const MapFormat *outputFormat)
+{
+    const MapFormat *sourceFormat = findSupportingMapFormat(sourceFile);
+
+    // Files not supported by any format are read as TMX
+    if (!sourceFormat)
+        return outputFormat->shortName() != QLatin1String("tmx");
+
+    return sourceFormat != outputFormat && !isScriptFormat(sourceFormat);
+}
+
+/**
+ * Handles the --export-maps option, which exports any number of maps to
+ * the given output directory.
+ *
+ * Since reading a map creates pixmaps and shares tilesets through the
+ * TilesetManager, the maps are loaded one by one on the main thread, which
+ * allows tilesets and images to be shared between all maps. While a map is
+ * being loaded, the previous one is written out by a worker thread.
+ *
+ * Returns the exit code.
+ */
+int exportMaps(const QStringList &arguments)
+{
+    if (arguments.length() < 3) {
+        qWarning().noquote() << QCoreApplication::translate("Command line", "Export syntax is --export-maps <format> <output directory> <source>...");
+        return 1;
+    }
+
+    PluginManager::instance()->loadPlugins();
+
+    const QString &filter = arguments.at(0);
+    const QDir outputDir(arguments.at(1));
+    const QStringList sourceFiles = expandMapSources(arguments.mid(2));
+
+    QString errorMsg;
+    MapFormat *outputFormat = findExportFormat<MapFormat>(&filter, QString(), errorMsg);
+    if (!outputFormat) {
+        Q_ASSERT(!errorMsg.isEmpty());
+        qWarning().noquote() << errorMsg;
+        return 1;
+    }
+
+    if (!outputDir.exists() && !outputDir.mkpath(QLatin1String("."))) {
+        qWarning().noquote() << QCoreApplication::translate("Command line", "Failed to create output directory %1").arg(outputDir.path());
+        return 1;
+    }
+
+    QString suffix;
+    const QStringList extensions = Utils::cleanFilterList(outputFormat->nameFilter());
+    if (!extensions.isEmpty())
+        suffix = extensions.first().mid(extensions.first().indexOf(QLatin1Char('.')));
+
+    struct WriteResult
+    {
+        bool success;
+        QString error;
+        qint64 elapsed;
+    };
+
+    // Writes are not done in parallel with each other, since file formats
+    // are not expected to be reentrant. Script-based formats are written on
+    // the main thread.
+    const bool writeOnWorker = !isScriptFormat(outputFormat);
+
+    auto write = [outputFormat] (const Map *map, const QString &targetFile) {
+        QElapsedTimer timer;
+        timer.start();
+        const bool success = outputFormat->write(map, targetFile);
+        return WriteResult { success,
+                             success ? QString() : outputFormat->errorString(),
+                             timer.elapsed() };
+    };
+
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+
+    QSet<QString> targetFiles;
+    QScopedPointer<Map> pendingMap;
+    QFuture<WriteResult> pendingWrite;
+    WriteResult pendingResult { false, QString(), 0 };
+    QString pendingSource;
+    qint64 pendingLoadTime = 0;
+    int failures = 0;
+
+    auto finishPendingWrite = [&] {
+        if (!pendingMap)
+            return;
+
+        const WriteResult result = writeOnWorker ? pendingWrite.result()
+                                                 : pendingResult;
+        if (result.success) {
+            qWarning().noquote() << QCoreApplication::translate("Command line", "Exported %1 (load %2 ms, write %3 ms)")
+                                    .arg(pendingSource)
+                                    .arg(pendingLoadTime)
+                                    .arg(result.elapsed);
+        } else {
+            qWarning().noquote() << QCoreApplication::translate("Command line", "Failed to export %1: %2")
+                                    .arg(pendingSource, result.error);
+            ++failures;
+        }
+
+        // Tilesets are released on the main thread, like they were loaded
+        pendingMap.reset();
+    };
+
+    for (const QString &sourceFile : sourceFiles) {
+        const QString targetFile = outputDir.filePath(QFileInfo(sourceFile).completeBaseName() + suffix);
+        if (targetFiles.contains(targetFile)) {
+            qWarning().noquote() << QCoreApplication::translate("Command line", "Failed to export %1: %2 was already written")
+                                    .arg(sourceFile, targetFile);
+            ++failures;
+            continue;
+        }
+        targetFiles.insert(targetFile);
+
+        if (!canReadWhileWriting(sourceFile, outputFormat))
+            finishPendingWrite();
+
+        QElapsedTimer loadTimer;
+        loadTimer.start();
+
+        QString error;
+        Map *map = readMap(sourceFile, &error);
+        const qint64 loadTime = loadTimer.elapsed();
+
+        finishPendingWrite();
+
+        if (!map) {
+            qWarning().noquote() << QCoreApplication::translate("Command line", "Failed to load %1: %2")
+                                    .arg(sourceFile, error);
+            ++failures;
+            continue;
+        }
+
+        pendingMap.reset(map);
+        pendingSource = sourceFile;
+        pendingLoadTime = loadTime;
+        if (writeOnWorker)
+            pendingWrite = QtConcurrent::run([=] { return write(map, targetFile); });
+        else
+            pendingResult = write(map, targetFile);
+    }
+
+    finishPendingWrite();
+
+    qWarning().noquote() << QCoreApplication::translate("Command line", "Exported %1 of %2 maps in %3 ms")
+                            .arg(sourceFiles.size() - failures)
+                            .arg(sourceFiles.size())
+                            .arg(totalTimer.elapsed());
+
+    const ImageCache::Statistics cacheStatistics = ImageCache::statistics();
+    qWarning().noquote() << QCoreApplication::translate("Command line", "Image cache: %1 hits, %2 misses, %3 evictions")
+                            .arg(cacheStatistics.hits)
+                            .arg(cacheStatistics.misses)
+                            .arg(cacheStatistics.evictions);
+
+    return failures > 0 ? 1 : 0;
+}
+
 
 } // anonymous namespace
 
@@ -152,6 +387,7 @@ CommandLineHandler::CommandLineHandler()
     , showedVersion(false)
     , disableOpenGL(false)
     , exportMap(false)
+    , exportMaps(false)
     , exportTileset(false)
     , newInstance(false)
 {
@@ -175,6 +411,11 @@ CommandLineHandler::CommandLineHandler()
                 QLatin1String("--export-map"),
                 tr("Export the specified map file to target"));
 
+    option<&CommandLineHandler::setExportMaps>(
+                QChar(),
+                QLatin1String("--export-maps"),
+                tr("Export the specified map files to a directory"));
+
     option<&CommandLineHandler::setExportTileset>(
                 QChar(),
                 QLatin1String("--export-tileset"),
@@ -216,6 +457,11 @@ void CommandLineHandler::setExportMap()
     exportMap = true;
 }
 
+void CommandLineHandler::setExportMaps()
+{
+    exportMaps = true;
+}
+
 void CommandLineHandler::setExportTileset()
 {
     exportTileset = true;
@@ -316,6 +562,17 @@ int main(int argc, char *argv[])
     if (commandLine.disableOpenGL)
         Preferences::instance()->setUseOpenGL(false);
 
+    ImageCache::setMemoryLimit(qint64(Preferences::instance()->imageCacheSize()) * 1024 * 1024);
+
+    if (commandLine.exportMaps) {
+        if (commandLine.exportMap || commandLine.exportTileset) {
+            qWarning().noquote() << QCoreApplication::translate("Command line", "Export syntax is --export-maps <format> <output directory> <source>...");
+            return 1;
+        }
+
+        return exportMaps(commandLine.filesToOpen());
+    }
+
     if (commandLine.exportMap) {
         // Get the path to the source file and target file
         if (commandLine.exportTileset || commandLine.filesToOpen().length() < 2) {
@@ -65,7 +65,7 @@ MainToolBar::MainToolBar(QWidget *parent)
     mNewButton->setPopupMode(QToolButton::InstantPopup);
 
     QUndoGroup *undoGroup = DocumentManager::instance()->undoGroup();
-    mUndoAction = undoGroup->createUndoAction(this, tr("Undo"));
+    mUndoAction = DocumentManager::instance()->createUndoAction(this, tr("Undo"));
     mRedoAction = undoGroup->createRedoAction(this, tr("Redo"));
 
     mNewButton->setIcon(newIcon);
@@ -235,7 +235,7 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
 #endif
 
     QUndoGroup *undoGroup = mDocumentManager->undoGroup();
-    QAction *undoAction = undoGroup->createUndoAction(this, tr("Undo"));
+    QAction *undoAction = mDocumentManager->createUndoAction(this, tr("Undo"));
     QAction *redoAction = undoGroup->createRedoAction(this, tr("Redo"));
     redoAction->setIcon(redoIcon);
     undoAction->setIcon(undoIcon);
@@ -285,6 +285,7 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
     mUi->actionSnapToPixels->setChecked(preferences->snapToPixels());
     mUi->actionHighlightCurrentLayer->setChecked(preferences->highlightCurrentLayer());
     mUi->actionAutoMapWhileDrawing->setChecked(preferences->automappingDrawing());
+    mUi->actionAutoMapParallel->setChecked(preferences->automappingParallel());
 
 #ifdef Q_OS_MAC
     mUi->actionFullScreen->setShortcuts(QKeySequence::FullScreen);
@@ -441,6 +442,8 @@ MainWindow::MainWindow(QWidget *parent, Qt::WindowFlags flags)
             mAutomappingManager, &AutomappingManager::autoMap);
     connect(mUi->actionAutoMapWhileDrawing, &QAction::toggled,
             preferences, &Preferences::setAutomappingDrawing);
+    connect(mUi->actionAutoMapParallel, &QAction::toggled,
+            preferences, &Preferences::setAutomappingParallel);
     connect(mUi->actionMapProperties, &QAction::triggered,
             this, &MainWindow::editMapProperties);
 
@@ -59,6 +59,7 @@
 #include "tilelayer.h"
 #include "tilesetdocument.h"
 #include "tmxmapformat.h"
+#include "undocommands.h"
 
 #include <QFileInfo>
 #include <QRect>
@@ -114,6 +115,9 @@ MapDocument::MapDocument(Map *map, const QString &fileName)
 
     connect(TemplateManager::instance(), &TemplateManager::objectTemplateChanged,
             this, &MapDocument::updateTemplateInstances);
+
+    connect(mUndoStack, &QUndoStack::indexChanged,
+            this, &MapDocument::limitUndoMemory);
 }
 
 MapDocument::~MapDocument()
@@ -345,7 +349,7 @@ void MapDocument::autocropMap()
 
     TileLayer *tileLayer = static_cast<TileLayer*>(mCurrentLayer);
 
-    const QRect bounds = tileLayer->region().boundingRect();
+    const QRect bounds = tileLayer->filledBounds();
     if (bounds.isNull())
         return;
 
@@ -1044,6 +1048,41 @@ void MapDocument::onLayerRemoved(Layer *layer)
     emit layerRemoved(layer);
 }
 
+/**
+ * Keeps the memory used by the undo history within the limit set in the
+ * preferences, by collapsing the oldest commands.
+ *
+ * Undoing collapsed commands would no longer restore a previous state of the
+ * map, so they are kept below the undo floor. Document::canUndo() returns
+ * false at the floor, which disables the Undo actions and the History view.
+ */
+void MapDocument::limitUndoMemory()
+{
+    const int index = mUndoStack->index();
+
+    // The undo stack was cleared
+    if (mUndoStack->count() < mUndoFloor)
+        mUndoFloor = 0;
+
+    const qint64 limit = qint64(Preferences::instance()->undoMemoryLimit()) * 1024 * 1024;
+    if (limit <= 0)
+        return;
+
+    qint64 usage = 0;
+    for (int i = mUndoFloor; i < mUndoStack->count(); ++i)
+        usage += undoMemoryUsage(mUndoStack->command(i));
+
+    // Always keep the last step before the current index undoable
+    while (usage > limit && mUndoFloor < index - 1) {
+        const QUndoCommand *command = mUndoStack->command(mUndoFloor);
+        usage -= undoMemoryUsage(command);
+
+        // QUndoStack only provides const access, but the commands are ours
+        collapseUndoCommand(const_cast<QUndoCommand*>(command));
+        ++mUndoFloor;
+    }
+}
+
 void MapDocument::updateTemplateInstances(const ObjectTemplate *objectTemplate)
 {
     QList<MapObject*> objectList;
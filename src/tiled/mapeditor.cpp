@@ -390,7 +390,7 @@ void MapEditor::setCurrentDocument(Document *document)
     }
 
     mPropertiesDock->setDocument(mapDocument);
-    mUndoDock->setStack(document ? document->undoStack() : nullptr);
+    mUndoDock->setDocument(document);
     mObjectsDock->setMapDocument(mapDocument);
     mTilesetDock->setMapDocument(mapDocument);
     mTerrainDock->setDocument(mapDocument);
@@ -630,7 +630,7 @@ static void normalizeTileLayerPositionsAndMapSize(Map *map)
 
     QRect contentRect;
     while (auto tileLayer = static_cast<TileLayer*>(it.next()))
-        contentRect |= tileLayer->region().boundingRect();
+        contentRect |= tileLayer->filledBounds();
 
     if (!contentRect.isEmpty()) {
         QPoint offset = contentRect.topLeft();
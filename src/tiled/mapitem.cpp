@@ -20,6 +20,7 @@
 
 #include "mapitem.h"
 
+#include "containerhelpers.h"
 #include "grouplayer.h"
 #include "grouplayeritem.h"
 #include "imagelayeritem.h"
@@ -27,31 +28,47 @@
 #include "mapobjectitem.h"
 #include "maprenderer.h"
 #include "mapview.h"
+#include "objectgroup.h"
 #include "objectgroupitem.h"
 #include "objectselectionitem.h"
 #include "preferences.h"
+#include "tile.h"
 #include "tilelayer.h"
 #include "tilelayeritem.h"
 #include "tileselectionitem.h"
+#include "tilesetmanager.h"
 #include "zoomable.h"
 
 #include <QCursor>
 #include <QGraphicsSceneMouseEvent>
+#include <QPainterPath>
 #include <QPen>
+#include <QTransform>
 #include <QWidget>
 
+#include "qtcompat_p.h"
+
+#include <algorithm>
+
 namespace Tiled {
 namespace Internal {
 
 static const qreal darkeningFactor = 0.6;
 static const qreal opacityFactor = 0.4;
 
+static bool useBatchObjectRendering(const MapDocument *mapDocument)
+{
+    return Preferences::instance()->batchObjectRendering() &&
+            mapDocument->map()->orientation() == Map::Orthogonal;
+}
+
 MapItem::MapItem(MapDocument *mapDocument, DisplayMode displayMode,
                  QGraphicsItem *parent)
     : QGraphicsObject(parent)
     , mMapDocument(mapDocument->sharedFromThis())
     , mDarkRectangle(new QGraphicsRectItem(this))
     , mDisplayMode(displayMode)
+    , mBatchObjects(useBatchObjectRendering(mapDocument))
 {
     // Since we don't do any painting, we can spare us the call to paint()
     setFlag(QGraphicsItem::ItemHasNoContents);
@@ -80,6 +97,10 @@ MapItem::MapItem(MapDocument *mapDocument, DisplayMode displayMode,
     connect(prefs, &Preferences::showTileObjectOutlinesChanged, this, &MapItem::setShowTileObjectOutlines);
     connect(prefs, &Preferences::highlightCurrentLayerChanged, this, &MapItem::updateCurrentLayerHighlight);
     connect(prefs, &Preferences::objectTypesChanged, this, &MapItem::syncAllObjectItems);
+    connect(prefs, &Preferences::batchObjectRenderingChanged, this, &MapItem::updateBatchObjectRendering);
+
+    connect(TilesetManager::instance(), &TilesetManager::tilesetImagesChanged,
+            this, &MapItem::tilesetImagesChanged);
 
     connect(mapDocument, &MapDocument::mapChanged, this, &MapItem::mapChanged);
     connect(mapDocument, &MapDocument::regionChanged, this, &MapItem::repaintRegion);
@@ -92,6 +113,7 @@ MapItem::MapItem(MapDocument *mapDocument, DisplayMode displayMode,
     connect(mapDocument, &MapDocument::selectedLayersChanged, this, &MapItem::updateCurrentLayerHighlight);
     connect(mapDocument, &MapDocument::tilesetTileOffsetChanged, this, &MapItem::adaptToTilesetTileSizeChanges);
     connect(mapDocument, &MapDocument::tileImageSourceChanged, this, &MapItem::adaptToTileSizeChanges);
+    connect(mapDocument, &MapDocument::tileAnimationChanged, this, &MapItem::tileAnimationChanged);
     connect(mapDocument, &MapDocument::tilesetReplaced, this, &MapItem::tilesetReplaced);
     connect(mapDocument, &MapDocument::objectsInserted, this, &MapItem::objectsInserted);
     connect(mapDocument, &MapDocument::objectsRemoved, this, &MapItem::objectsRemoved);
@@ -117,6 +139,135 @@ void MapItem::paint(QPainter *, const QStyleOptionGraphicsItem *, QWidget *)
 {
 }
 
+/**
+ * Returns whether objectsInRect() and objectsAt() can be used. This is only
+ * the case for orthogonal maps, where the screen coordinates of the objects
+ * match their pixel coordinates, so the spatial index of the object groups
+ * can be used.
+ */
+bool MapItem::canFindObjectsInRect() const
+{
+    return mMapDocument->map()->orientation() == Map::Orthogonal;
+}
+
+// The point marker and the outline of objects without a size can extend
+// this far beyond their bounds. Since outlines are drawn with a cosmetic pen,
+// the margin grows in map pixels when zoomed out.
+static qreal objectMargin(const MapRenderer *renderer)
+{
+    const qreal ObjectMargin = 30;
+    return ObjectMargin / qMin<qreal>(1, renderer->painterScale());
+}
+
+/*
+ * Returns the shape of the given \a object in the coordinates of its object
+ * group item, matching the shape of its MapObjectItem.
+ */
+static QPainterPath objectShape(const MapRenderer *renderer, const MapObject *object)
+{
+    QPainterPath shape = renderer->shape(object);
+
+    if (object->rotation() != 0.0) {
+        const QPointF pos = renderer->pixelToScreenCoords(object->position());
+        QTransform transform;
+        transform.translate(pos.x(), pos.y());
+        transform.rotate(object->rotation());
+        transform.translate(-pos.x(), -pos.y());
+        shape = transform.map(shape);
+    }
+
+    return shape;
+}
+
+/**
+ * Returns the visible objects in enabled, visible and unlocked layers whose
+ * shape intersects the given \a rect in scene coordinates, like their items
+ * would be found by QGraphicsScene::items().
+ *
+ * Uses the spatial index of the object groups, so it does not depend on each
+ * object having an item. Should only be used when canFindObjectsInRect() is
+ * true.
+ */
+QList<MapObject*> MapItem::objectsInRect(const QRectF &rect) const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const qreal margin = objectMargin(renderer);
+
+    QPainterPath path;
+    path.addRect(rect);
+
+    QList<MapObject*> objects;
+
+    LayerIterator iterator(mMapDocument->map(), Layer::ObjectGroupType);
+    while (ObjectGroup *objectGroup = static_cast<ObjectGroup*>(iterator.next())) {
+        const LayerItem *layerItem = mLayerItems.value(objectGroup);
+        if (!layerItem || !layerItem->isVisible() || !layerItem->isEnabled())
+            continue;
+        if (!objectGroup->isUnlocked())
+            continue;
+
+        const QPainterPath layerPath = layerItem->mapFromScene(path);
+        const QRectF searchRect = layerPath.boundingRect().adjusted(-margin, -margin,
+                                                                    margin, margin);
+
+        for (MapObject *object : objectGroup->objectsInRect(searchRect)) {
+            if (object->isVisible() && objectShape(renderer, object).intersects(layerPath))
+                objects.append(object);
+        }
+    }
+
+    return objects;
+}
+
+/**
+ * Returns the visible objects in enabled, visible and unlocked layers whose
+ * shape contains the given \a pos in scene coordinates. The top-most object
+ * comes first, like for QGraphicsScene::items().
+ *
+ * Should only be used when canFindObjectsInRect() is true.
+ */
+QList<MapObject*> MapItem::objectsAt(const QPointF &pos) const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const qreal margin = objectMargin(renderer);
+
+    QList<MapObject*> objects;
+
+    LayerIterator iterator(mMapDocument->map(), Layer::ObjectGroupType);
+    while (ObjectGroup *objectGroup = static_cast<ObjectGroup*>(iterator.next())) {
+        const LayerItem *layerItem = mLayerItems.value(objectGroup);
+        if (!layerItem || !layerItem->isVisible() || !layerItem->isEnabled())
+            continue;
+        if (!objectGroup->isUnlocked())
+            continue;
+
+        const QPointF layerPos = layerItem->mapFromScene(pos);
+        const QRectF searchRect(layerPos.x() - margin, layerPos.y() - margin,
+                                margin * 2, margin * 2);
+
+        QList<MapObject*> candidates = objectGroup->objectsInRect(searchRect);
+
+        // Match the stacking order of the object items
+        if (objectGroup->drawOrder() == ObjectGroup::TopDownOrder) {
+            std::stable_sort(candidates.begin(), candidates.end(),
+                             [] (const MapObject *a, const MapObject *b) {
+                return a->y() < b->y();
+            });
+        }
+
+        // Layers are iterated from the bottom, so objects of this layer go
+        // before the ones found so far
+        int insertIndex = 0;
+        for (int i = candidates.size() - 1; i >= 0; --i) {
+            MapObject *object = candidates.at(i);
+            if (object->isVisible() && objectShape(renderer, object).contains(layerPos))
+                objects.insert(insertIndex++, object);
+        }
+    }
+
+    return objects;
+}
+
 void MapItem::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
     if (mDisplayMode != ReadOnly)
@@ -138,12 +289,39 @@ void MapItem::mouseReleaseEvent(QGraphicsSceneMouseEvent *event)
     QGraphicsItem::mouseReleaseEvent(event);
 }
 
+/**
+ * Repaints the parts of the map showing any of the given \a tiles from
+ * \a tileset, for example because their animation advanced.
+ */
+void MapItem::repaintTiles(Tileset *tileset, const QList<Tile*> &tiles)
+{
+    const QSet<Tile*> tileSet = tiles.toSet();
+
+    for (QGraphicsItem *item : mLayerItems)
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+            tli->repaintTiles(tileSet);
+
+    for (MapObjectItem *item : mObjectItems) {
+        const Cell &cell = item->mapObject()->cell();
+        if (cell.tileset() == tileset && tileSet.contains(cell.tile()))
+            item->update();
+    }
+
+    if (mBatchObjects) {
+        for (LayerItem *layerItem : qAsConst(mLayerItems))
+            if (ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(layerItem))
+                ogItem->repaintTiles(tileset, tileSet);
+    }
+}
+
 void MapItem::repaintRegion(const QRegion &region, TileLayer *tileLayer)
 {
     const MapRenderer *renderer = mapDocument()->renderer();
     const QMargins margins = mapDocument()->map()->drawMargins();
     TileLayerItem *tileLayerItem = static_cast<TileLayerItem*>(mLayerItems.value(tileLayer));
 
+    tileLayerItem->invalidateChunks(region.translated(-tileLayer->position()));
+
 #if QT_VERSION < 0x050800
     const auto rects = region.rects();
     for (const QRect &r : rects) {
@@ -173,6 +351,11 @@ void MapItem::mapChanged()
     for (MapObjectItem *item : mObjectItems)
         item->syncWithMapObject();
 
+    // The orientation may have changed, which affects batch rendering
+    updateBatchObjectRendering();
+    syncBatchedObjectGroupItems();
+
+    invalidateChunks();
     updateBoundingRect();
 }
 
@@ -180,6 +363,7 @@ void MapItem::tileLayerChanged(TileLayer *tileLayer, MapDocument::TileLayerChang
 {
     TileLayerItem *item = static_cast<TileLayerItem*>(mLayerItems.value(tileLayer));
     item->syncWithTileLayer();
+    item->invalidateChunks();
 
     if (flags & MapDocument::LayerBoundsChanged)
         updateBoundingRect();
@@ -310,6 +494,9 @@ void MapItem::adaptToTilesetTileSizeChanges(Tileset *tileset)
         if (cell.tileset() == tileset)
             item->syncWithMapObject();
     }
+
+    syncBatchedObjectGroupItems();
+    invalidateChunks();
 }
 
 void MapItem::adaptToTileSizeChanges(Tile *tile)
@@ -323,6 +510,27 @@ void MapItem::adaptToTileSizeChanges(Tile *tile)
         if (cell.tile() == tile)
             item->syncWithMapObject();
     }
+
+    syncBatchedObjectGroupItems();
+    invalidateChunks();
+}
+
+void MapItem::tilesetImagesChanged(Tileset *tileset)
+{
+    if (!contains(mapDocument()->map()->tilesets(), tileset))
+        return;
+
+    invalidateChunks();
+
+    // The size of the tile objects may have changed
+    syncBatchedObjectGroupItems();
+}
+
+void MapItem::tileAnimationChanged(Tile *tile)
+{
+    // The tile may have started or stopped being animated
+    invalidateChunks();
+    repaintTiles(tile->tileset(), QList<Tile*>() << tile);
 }
 
 void MapItem::tilesetReplaced(int index, Tileset *tileset)
@@ -350,19 +558,17 @@ void MapItem::objectsInserted(ObjectGroup *objectGroup, int first, int last)
 
     Q_ASSERT(ogItem);
 
-    const ObjectGroup::DrawOrder drawOrder = objectGroup->drawOrder();
+    QList<MapObject*> objects;
 
     for (int i = first; i <= last; ++i) {
         MapObject *object = objectGroup->objectAt(i);
+        objects.append(object);
 
-        MapObjectItem *item = new MapObjectItem(object, mapDocument(), ogItem);
-        if (drawOrder == ObjectGroup::TopDownOrder)
-            item->setZValue(item->y());
-        else
-            item->setZValue(i);
-
-        mObjectItems.insert(object, item);
+        if (!mBatchObjects)
+            createObjectItem(object, ogItem, i);
     }
+
+    ogItem->objectsChanged(objects);
 }
 
 /**
@@ -372,11 +578,21 @@ void MapItem::objectsRemoved(const QList<MapObject*> &objects)
 {
     for (MapObject *o : objects) {
         auto i = mObjectItems.find(o);
-        Q_ASSERT(i != mObjectItems.end());
+        Q_ASSERT(i != mObjectItems.end() || mBatchObjects);
+        if (i == mObjectItems.end())
+            continue;
 
         delete i.value();
         mObjectItems.erase(i);
     }
+
+    // The objects are no longer part of their object group, so let all
+    // object group items know about them
+    if (mBatchObjects) {
+        for (LayerItem *layerItem : qAsConst(mLayerItems))
+            if (ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(layerItem))
+                ogItem->objectsRemoved(objects);
+    }
 }
 
 /**
@@ -384,12 +600,20 @@ void MapItem::objectsRemoved(const QList<MapObject*> &objects)
  */
 void MapItem::objectsChanged(const QList<MapObject*> &objects)
 {
-    for (MapObject *object : objects) {
-        MapObjectItem *item = mObjectItems.value(object);
-        Q_ASSERT(item);
-
-        item->syncWithMapObject();
+    if (mBatchObjects) {
+        QHash<ObjectGroup*, QList<MapObject*>> objectsPerGroup;
+        for (MapObject *object : objects)
+            objectsPerGroup[object->objectGroup()].append(object);
+
+        for (auto it = objectsPerGroup.begin(); it != objectsPerGroup.end(); ++it)
+            if (ObjectGroupItem *ogItem = objectGroupItem(it.key()))
+                ogItem->objectsChanged(it.value());
+        return;
     }
+
+    for (MapObject *object : objects)
+        if (MapObjectItem *item = mObjectItems.value(object))
+            item->syncWithMapObject();
 }
 
 /**
@@ -403,16 +627,93 @@ void MapItem::objectsIndexChanged(ObjectGroup *objectGroup,
 
     for (int i = first; i <= last; ++i) {
         MapObjectItem *item = mObjectItems.value(objectGroup->objectAt(i));
-        Q_ASSERT(item);
+        Q_ASSERT(item || mBatchObjects);
 
-        item->setZValue(i);
+        if (item)
+            item->setZValue(i);
     }
+
+    if (mBatchObjects)
+        if (ObjectGroupItem *ogItem = objectGroupItem(objectGroup))
+            ogItem->update();
 }
 
 void MapItem::syncAllObjectItems()
 {
     for (MapObjectItem *item : mObjectItems)
         item->syncWithMapObject();
+
+    syncBatchedObjectGroupItems();
+}
+
+/**
+ * Switches between drawing objects using an item for each object and
+ * drawing them in batches by their object group items, depending on the
+ * preference and the map orientation.
+ */
+void MapItem::updateBatchObjectRendering()
+{
+    const bool batchObjects = useBatchObjectRendering(mapDocument());
+    if (mBatchObjects == batchObjects)
+        return;
+
+    mBatchObjects = batchObjects;
+
+    qDeleteAll(mObjectItems);
+    mObjectItems.clear();
+
+    for (LayerItem *layerItem : qAsConst(mLayerItems)) {
+        if (ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(layerItem)) {
+            ogItem->setBatchRendering(mBatchObjects ? mapDocument() : nullptr);
+            createObjectItems(ogItem);
+        }
+    }
+}
+
+void MapItem::syncBatchedObjectGroupItems()
+{
+    if (!mBatchObjects)
+        return;
+
+    for (LayerItem *layerItem : qAsConst(mLayerItems))
+        if (ObjectGroupItem *ogItem = dynamic_cast<ObjectGroupItem*>(layerItem))
+            ogItem->syncWithObjectGroup();
+}
+
+/**
+ * Creates the items for the objects of the given object group item, unless
+ * the objects are drawn in batches by the object group item itself.
+ */
+void MapItem::createObjectItems(ObjectGroupItem *ogItem)
+{
+    if (mBatchObjects)
+        return;
+
+    int objectIndex = 0;
+    for (MapObject *object : ogItem->objectGroup()->objects())
+        createObjectItem(object, ogItem, objectIndex++);
+}
+
+MapObjectItem *MapItem::createObjectItem(MapObject *object,
+                                         ObjectGroupItem *ogItem,
+                                         int index)
+{
+    MapObjectItem *item = new MapObjectItem(object, mapDocument(), ogItem);
+    if (ogItem->objectGroup()->drawOrder() == ObjectGroup::TopDownOrder)
+        item->setZValue(item->y());
+    else
+        item->setZValue(index);
+
+    mObjectItems.insert(object, item);
+    return item;
+}
+
+ObjectGroupItem *MapItem::objectGroupItem(ObjectGroup *objectGroup) const
+{
+    if (!objectGroup)
+        return nullptr;
+
+    return static_cast<ObjectGroupItem*>(mLayerItems.value(objectGroup));
 }
 
 
@@ -427,6 +728,8 @@ void MapItem::setObjectLineWidth(qreal lineWidth)
             item->update();
         }
     }
+
+    syncBatchedObjectGroupItems();
 }
 
 void MapItem::setShowTileObjectOutlines(bool enabled)
@@ -437,6 +740,8 @@ void MapItem::setShowTileObjectOutlines(bool enabled)
         if (!item->mapObject()->cell().isEmpty())
             item->update();
     }
+
+    syncBatchedObjectGroupItems();
 }
 
 void MapItem::createLayerItems(const QList<Layer *> &layers)
@@ -465,20 +770,10 @@ LayerItem *MapItem::createLayerItem(Layer *layer)
 
     case Layer::ObjectGroupType: {
         auto og = static_cast<ObjectGroup*>(layer);
-        const ObjectGroup::DrawOrder drawOrder = og->drawOrder();
         ObjectGroupItem *ogItem = new ObjectGroupItem(og, parent);
-        int objectIndex = 0;
-        for (MapObject *object : og->objects()) {
-            MapObjectItem *item = new MapObjectItem(object, mapDocument(),
-                                                    ogItem);
-            if (drawOrder == ObjectGroup::TopDownOrder)
-                item->setZValue(item->y());
-            else
-                item->setZValue(objectIndex);
-
-            mObjectItems.insert(object, item);
-            ++objectIndex;
-        }
+        if (mBatchObjects)
+            ogItem->setBatchRendering(mapDocument());
+        createObjectItems(ogItem);
         layerItem = ogItem;
         break;
     }
@@ -505,6 +800,13 @@ LayerItem *MapItem::createLayerItem(Layer *layer)
     return layerItem;
 }
 
+void MapItem::invalidateChunks()
+{
+    for (QGraphicsItem *item : mLayerItems)
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+            tli->invalidateChunks();
+}
+
 void MapItem::updateBoundingRect()
 {
     QRectF boundingRect = mapDocument()->renderer()->mapBoundingRect();
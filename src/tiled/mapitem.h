@@ -41,6 +41,7 @@ namespace Internal {
 
 class LayerItem;
 class MapObjectItem;
+class ObjectGroupItem;
 
 /**
  * A graphics item that represents the contents of a map.
@@ -63,6 +64,12 @@ public:
 
     MapDocument *mapDocument() const;
 
+    void repaintTiles(Tileset *tileset, const QList<Tile*> &tiles);
+
+    bool canFindObjectsInRect() const;
+    QList<MapObject*> objectsInRect(const QRectF &rect) const;
+    QList<MapObject*> objectsAt(const QPointF &pos) const;
+
     // QGraphicsItem
     QRectF boundingRect() const override;
     void paint(QPainter *, const QStyleOptionGraphicsItem *,
@@ -94,6 +101,8 @@ private:
 
     void adaptToTilesetTileSizeChanges(Tileset *tileset);
     void adaptToTileSizeChanges(Tile *tile);
+    void tilesetImagesChanged(Tileset *tileset);
+    void tileAnimationChanged(Tile *tile);
 
     void tilesetReplaced(int index, Tileset *tileset);
 
@@ -104,12 +113,19 @@ private:
 
     void syncAllObjectItems();
 
+    void updateBatchObjectRendering();
+    void syncBatchedObjectGroupItems();
+    void createObjectItems(ObjectGroupItem *ogItem);
+    MapObjectItem *createObjectItem(MapObject *object, ObjectGroupItem *ogItem, int index);
+    ObjectGroupItem *objectGroupItem(ObjectGroup *objectGroup) const;
+
     void setObjectLineWidth(qreal lineWidth);
     void setShowTileObjectOutlines(bool enabled);
 
     void createLayerItems(const QList<Layer *> &layers);
     LayerItem *createLayerItem(Layer *layer);
 
+    void invalidateChunks();
     void updateBoundingRect();
     void updateCurrentLayerHighlight();
 
@@ -118,6 +134,7 @@ private:
     QMap<Layer*, LayerItem*> mLayerItems;
     QMap<MapObject*, MapObjectItem*> mObjectItems;
     DisplayMode mDisplayMode;
+    bool mBatchObjects;     // Objects are drawn by their ObjectGroupItem
     QRectF mBoundingRect;
 };
 
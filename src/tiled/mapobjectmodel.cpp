@@ -29,6 +29,7 @@
 #include "mapdocument.h"
 #include "objectgroup.h"
 #include "renamelayer.h"
+#include "tilesetmanager.h"
 
 #include <QApplication>
 #include <QPalette>
@@ -44,6 +45,10 @@ MapObjectModel::MapObjectModel(QObject *parent):
     mObjectGroupIcon(QLatin1String(":/images/16x16/layer-object.png"))
 {
     mObjectGroupIcon.addFile(QLatin1String(":images/32x32/layer-object.png"));
+
+    // Reloading a tileset can change the size of its tiles
+    connect(TilesetManager::instance(), &TilesetManager::tilesetImagesChanged,
+            this, &MapObjectModel::updateTilesetObjectIndexes);
 }
 
 QModelIndex MapObjectModel::index(int row, int column,
@@ -361,6 +366,16 @@ void MapObjectModel::setMapDocument(MapDocument *mapDocument)
                 this, &MapObjectModel::layerAboutToBeRemoved);
         connect(mMapDocument, &MapDocument::tileTypeChanged,
                 this, &MapObjectModel::tileTypeChanged);
+
+        // Keep the spatial indexes of the object groups up to date
+        connect(mMapDocument, &MapDocument::objectsChanged,
+                this, &MapObjectModel::updateObjectIndex);
+        connect(mMapDocument, &MapDocument::tileImageSourceChanged,
+                this, &MapObjectModel::invalidateObjectIndexes);
+        connect(mMapDocument, &MapDocument::tilesetTileOffsetChanged,
+                this, &MapObjectModel::updateTilesetObjectIndexes);
+        connect(mMapDocument, &MapDocument::tilesetReplaced,
+                this, &MapObjectModel::invalidateObjectIndexes);
     }
 
     endResetModel();
@@ -438,6 +453,38 @@ void MapObjectModel::tileTypeChanged(Tile *tile)
     }
 }
 
+void MapObjectModel::updateObjectIndex(const QList<MapObject *> &objects)
+{
+    for (MapObject *object : objects)
+        if (ObjectGroup *objectGroup = object->objectGroup())
+            objectGroup->updateIndex(object);
+}
+
+void MapObjectModel::invalidateObjectIndexes()
+{
+    LayerIterator iterator(mMap, Layer::ObjectGroupType);
+    while (Layer *layer = iterator.next())
+        static_cast<ObjectGroup*>(layer)->invalidateIndex();
+}
+
+/**
+ * Updates the spatial index for the tile objects using the given
+ * \a tileset, since their bounds depend on its tile size and offset.
+ */
+void MapObjectModel::updateTilesetObjectIndexes(Tileset *tileset)
+{
+    if (!mMap)
+        return;
+
+    LayerIterator iterator(mMap, Layer::ObjectGroupType);
+    while (Layer *layer = iterator.next()) {
+        ObjectGroup *objectGroup = static_cast<ObjectGroup*>(layer);
+        for (MapObject *object : objectGroup->objects())
+            if (object->cell().tileset() == tileset)
+                objectGroup->updateIndex(object);
+    }
+}
+
 void MapObjectModel::emitObjectsChanged(const QList<MapObject *> &objects, const QList<Column> &columns)
 {
     emit objectsChanged(objects);
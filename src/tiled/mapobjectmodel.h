@@ -111,6 +111,9 @@ private slots:
     void layerChanged(Layer *layer);
     void layerAboutToBeRemoved(GroupLayer *groupLayer, int index);
     void tileTypeChanged(Tile *tile);
+    void updateObjectIndex(const QList<MapObject*> &objects);
+    void invalidateObjectIndexes();
+    void updateTilesetObjectIndexes(Tileset *tileset);
 
 private:
     MapDocument *mMapDocument;
@@ -0,0 +1,108 @@
+/*
+ * mapplaceholderitem.cpp
+ * Copyright 2018, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mapplaceholderitem.h"
+
+#include "map.h"
+#include "minimaprenderer.h"
+
+#include <QCache>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+using namespace Tiled;
+using namespace Tiled::Internal;
+
+// Thumbnails are at most this many pixels wide or high
+static const int ThumbnailSize = 256;
+
+// The cost of a cached thumbnail is its size in KB
+static QCache<QString, QImage> &thumbnailCache()
+{
+    static QCache<QString, QImage> cache(32 * 1024);
+    return cache;
+}
+
+MapPlaceholderItem::MapPlaceholderItem(const QString &fileName,
+                                       const QRect &rect,
+                                       QGraphicsItem *parent)
+    : QGraphicsItem(parent)
+    , mFileName(fileName)
+    , mRect(rect)
+{
+    if (const QImage *thumbnail = thumbnailCache().object(fileName))
+        mThumbnail = *thumbnail;
+
+    setOpacity(0.5);
+    setZValue(-1);
+}
+
+QRectF MapPlaceholderItem::boundingRect() const
+{
+    return mRect;
+}
+
+void MapPlaceholderItem::paint(QPainter *painter,
+                               const QStyleOptionGraphicsItem *option,
+                               QWidget *)
+{
+    if (!mThumbnail.isNull()) {
+        painter->setRenderHint(QPainter::SmoothPixmapTransform);
+        painter->drawImage(mRect, mThumbnail);
+        return;
+    }
+
+    const qreal lod = option->levelOfDetailFromTransform(painter->worldTransform());
+
+    QPen pen(Qt::gray, 1.0 / qMax(lod, qreal(0.001)), Qt::DashLine);
+    painter->setPen(pen);
+    painter->setBrush(QColor(128, 128, 128, 64));
+    painter->drawRect(mRect);
+}
+
+/**
+ * Renders and stores a thumbnail of the given \a map, to be shown by
+ * placeholders for the map with the given \a fileName. The \a size is the
+ * size of the area covered by the map in the world, which determines the
+ * aspect ratio of the thumbnail.
+ *
+ * Any previous thumbnail for the map is replaced, since the map may have
+ * changed.
+ */
+void MapPlaceholderItem::storeThumbnail(const QString &fileName, Map *map,
+                                        const QSize &size)
+{
+    if (size.isEmpty())
+        return;
+
+    const MiniMapRenderer renderer(map);
+    const QSize thumbnailSize = size.scaled(ThumbnailSize, ThumbnailSize,
+                                            Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+
+    QImage *thumbnail = new QImage(renderer.render(thumbnailSize,
+                                                   MiniMapRenderer::DrawTileLayers |
+                                                   MiniMapRenderer::DrawImageLayers |
+                                                   MiniMapRenderer::DrawMapObjects |
+                                                   MiniMapRenderer::IgnoreInvisibleLayer |
+                                                   MiniMapRenderer::SmoothPixmapTransform));
+
+    thumbnailCache().insert(fileName, thumbnail,
+                            qMax(1, thumbnail->byteCount() / 1024));
+}
@@ -0,0 +1,64 @@
+/*
+ * mapplaceholderitem.h
+ * Copyright 2018, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QGraphicsItem>
+#include <QImage>
+
+namespace Tiled {
+
+class Map;
+
+namespace Internal {
+
+/**
+ * Stands in for a map of the world that is not loaded, either because it is
+ * still waiting to be loaded or because it was unloaded after it went far
+ * out of view.
+ *
+ * Shows a thumbnail of the map when one was stored earlier, or otherwise
+ * only its outline.
+ */
+class MapPlaceholderItem : public QGraphicsItem
+{
+public:
+    MapPlaceholderItem(const QString &fileName,
+                       const QRect &rect,
+                       QGraphicsItem *parent = nullptr);
+
+    const QString &fileName() const { return mFileName; }
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter,
+               const QStyleOptionGraphicsItem *option,
+               QWidget *widget = nullptr) override;
+
+    static void storeThumbnail(const QString &fileName, Map *map,
+                               const QSize &size);
+
+private:
+    QString mFileName;
+    QRectF mRect;
+    QImage mThumbnail;
+};
+
+} // namespace Internal
+} // namespace Tiled
@@ -29,6 +29,7 @@
 #include "map.h"
 #include "mapitem.h"
 #include "mapobject.h"
+#include "mapplaceholderitem.h"
 #include "maprenderer.h"
 #include "objectgroup.h"
 #include "objecttemplate.h"
@@ -41,7 +42,9 @@
 
 #include <QApplication>
 #include <QGraphicsSceneMouseEvent>
+#include <QGraphicsView>
 #include <QKeyEvent>
+#include <QLineF>
 #include <QMimeData>
 #include <QPalette>
 
@@ -66,8 +69,8 @@ MapScene::MapScene(QObject *parent):
     TilesetManager *tilesetManager = TilesetManager::instance();
     connect(tilesetManager, &TilesetManager::tilesetImagesChanged,
             this, &MapScene::repaintTileset);
-    connect(tilesetManager, &TilesetManager::repaintTileset,
-            this, &MapScene::repaintTileset);
+    connect(tilesetManager, &TilesetManager::repaintTiles,
+            this, &MapScene::repaintTiles);
 
     Preferences *prefs = Preferences::instance();
     connect(prefs, &Preferences::showGridChanged, this, &MapScene::setGridVisible);
@@ -75,6 +78,10 @@ MapScene::MapScene(QObject *parent):
 
     mGridVisible = prefs->showGrid();
 
+    mContextMapTimer.setSingleShot(true);
+    mContextMapTimer.setInterval(0);
+    connect(&mContextMapTimer, &QTimer::timeout, this, &MapScene::updateContextMaps);
+
     // Install an event filter so that we can get key events on behalf of the
     // active tool without having to have the current focus.
     qApp->installEventFilter(this);
@@ -128,6 +135,10 @@ void MapScene::refreshScene()
 {
     clear();
     mMapItems.clear();
+    mContextMapRects.clear();
+    mContextMapItems.clear();
+    mPlaceholders.clear();
+    mContextMapTimer.stop();
 
     if (!mMapDocument) {
         setSceneRect(QRectF());
@@ -137,36 +148,24 @@ void MapScene::refreshScene()
     WorldManager &worldManager = WorldManager::instance();
 
     if (const World *world = worldManager.worldForMap(mMapDocument->fileName())) {
-        const QPoint currentMapPosition = world->mapRect(mMapDocument->fileName()).topLeft();
+        mCurrentMapPosition = world->mapRect(mMapDocument->fileName()).topLeft();
         auto const contextMaps = world->contextMaps(mMapDocument->fileName());
 
         for (const World::MapEntry &mapEntry : contextMaps) {
-            MapDocumentPtr mapDocument;
-
             if (mapEntry.fileName == mMapDocument->fileName()) {
-                mapDocument = mMapDocument->sharedFromThis();
-            } else {
-                auto doc = DocumentManager::instance()->loadDocument(mapEntry.fileName);
-                mapDocument = doc.objectCast<MapDocument>();
-            }
-
-            if (mapDocument) {
-                MapItem::DisplayMode displayMode = MapItem::ReadOnly;
-                if (mapDocument == mMapDocument)
-                    displayMode = MapItem::Editable;
-
-                auto mapItem = new MapItem(mapDocument.data(), displayMode);
-                mapItem->setPos(mapEntry.rect.topLeft() - currentMapPosition);
+                auto mapItem = new MapItem(mMapDocument, MapItem::Editable);
+                mapItem->setPos(mapEntry.rect.topLeft() - mCurrentMapPosition);
                 connect(mapItem, &MapItem::boundingRectChanged, this, &MapScene::updateSceneRect);
-                mMapItems.insert(mapDocument.data(), mapItem);
+                mMapItems.insert(mMapDocument, mapItem);
                 addItem(mapItem);
-
-                if (mapDocument != mMapDocument) {
-                    mapItem->setOpacity(0.5);
-                    mapItem->setZValue(-1);
-                }
+            } else if (!mContextMapRects.contains(mapEntry.fileName)) {
+                // Other maps are loaded later, see updateContextMaps()
+                mContextMapRects.insert(mapEntry.fileName, mapEntry.rect);
+                addPlaceholder(mapEntry.fileName);
             }
         }
+
+        mContextMapTimer.start();
     } else {
         auto mapItem = new MapItem(mMapDocument, MapItem::Editable);
         connect(mapItem, &MapItem::boundingRectChanged, this, &MapScene::updateSceneRect);
@@ -198,10 +197,158 @@ void MapScene::updateSceneRect()
 
     for (MapItem *mapItem : qAsConst(mMapItems))
         sceneRect |= mapItem->boundingRect().translated(mapItem->pos());
+    for (MapPlaceholderItem *placeholder : qAsConst(mPlaceholders))
+        sceneRect |= placeholder->boundingRect();
 
     setSceneRect(sceneRect);
 }
 
+/**
+ * Should be called when the visible area of a view showing this scene
+ * changed, so that the other maps of the world near the visible area can be
+ * loaded and those far away can be unloaded.
+ */
+void MapScene::viewportChanged()
+{
+    if (!mPlaceholders.isEmpty() || !mContextMapItems.isEmpty())
+        mContextMapTimer.start();
+}
+
+/**
+ * Unloads the other maps of the world that are far out of view and loads the
+ * one nearest to the visible area, when there are any within range.
+ *
+ * The maps are loaded on the GUI thread, since loading creates pixmaps and
+ * uses the shared TilesetManager. Only one map is loaded at a time, after
+ * which another update is scheduled. This keeps the editor responsive while
+ * loading the maps around the current one, though loading a large map still
+ * blocks it for a moment.
+ */
+void MapScene::updateContextMaps()
+{
+    QRectF visible = visibleArea();
+    if (visible.isEmpty()) {
+        if (MapItem *mapItem = mMapItems.value(mMapDocument))
+            visible = mapItem->boundingRect().translated(mapItem->pos());
+        else
+            return;
+    }
+
+    const qreal w = visible.width();
+    const qreal h = visible.height();
+    const QRectF loadArea = visible.adjusted(-w, -h, w, h);
+    const QRectF keepArea = visible.adjusted(-3 * w, -3 * h, 3 * w, 3 * h);
+
+    const auto contextMapItems = mContextMapItems;
+    for (auto it = contextMapItems.begin(); it != contextMapItems.end(); ++it) {
+        MapItem *mapItem = it.value();
+        if (!keepArea.intersects(mapItem->boundingRect().translated(mapItem->pos())))
+            unloadContextMap(it.key());
+    }
+
+    MapPlaceholderItem *nearest = nullptr;
+    qreal nearestDistance = 0;
+    int pending = 0;
+
+    for (MapPlaceholderItem *placeholder : qAsConst(mPlaceholders)) {
+        const QRectF rect = placeholder->boundingRect();
+        if (!loadArea.intersects(rect))
+            continue;
+
+        ++pending;
+
+        const qreal distance = QLineF(visible.center(), rect.center()).length();
+        if (!nearest || distance < nearestDistance) {
+            nearest = placeholder;
+            nearestDistance = distance;
+        }
+    }
+
+    if (nearest) {
+        loadContextMap(nearest);
+
+        if (pending > 1)
+            mContextMapTimer.start();
+    }
+}
+
+void MapScene::addPlaceholder(const QString &fileName)
+{
+    const QRect rect = mContextMapRects.value(fileName).translated(-mCurrentMapPosition);
+    auto placeholder = new MapPlaceholderItem(fileName, rect);
+    mPlaceholders.insert(fileName, placeholder);
+    addItem(placeholder);
+}
+
+/**
+ * Replaces the given \a placeholder with a read-only view of its map.
+ */
+void MapScene::loadContextMap(MapPlaceholderItem *placeholder)
+{
+    const QString fileName = placeholder->fileName();
+    mPlaceholders.remove(fileName);
+    delete placeholder;
+
+    auto doc = DocumentManager::instance()->loadDocument(fileName);
+    MapDocumentPtr mapDocument = doc.objectCast<MapDocument>();
+
+    // Maps that fail to load are not retried until the scene is refreshed
+    if (!mapDocument || mMapItems.contains(mapDocument.data())) {
+        updateSceneRect();
+        return;
+    }
+
+    const QRect rect = mContextMapRects.value(fileName);
+
+    auto mapItem = new MapItem(mapDocument.data(), MapItem::ReadOnly);
+    mapItem->setPos(rect.topLeft() - mCurrentMapPosition);
+    mapItem->setOpacity(0.5);
+    mapItem->setZValue(-1);
+    connect(mapItem, &MapItem::boundingRectChanged, this, &MapScene::updateSceneRect);
+    mMapItems.insert(mapDocument.data(), mapItem);
+    mContextMapItems.insert(fileName, mapItem);
+    addItem(mapItem);
+
+    MapPlaceholderItem::storeThumbnail(fileName, mapDocument->map(), rect.size());
+
+    updateSceneRect();
+}
+
+/**
+ * Replaces the read-only view of the map with the given \a fileName with a
+ * placeholder, releasing the map when it isn't used elsewhere.
+ */
+void MapScene::unloadContextMap(const QString &fileName)
+{
+    MapItem *mapItem = mContextMapItems.take(fileName);
+    if (!mapItem)
+        return;
+
+    // The map may have been changed while it was loaded
+    MapPlaceholderItem::storeThumbnail(fileName, mapItem->mapDocument()->map(),
+                                       mContextMapRects.value(fileName).size());
+
+    mMapItems.remove(mapItem->mapDocument());
+    delete mapItem;
+
+    addPlaceholder(fileName);
+}
+
+/**
+ * Returns the area of this scene that is visible in any of its views.
+ */
+QRectF MapScene::visibleArea() const
+{
+    QRectF area;
+
+    for (QGraphicsView *view : views()) {
+        const QRect viewportRect = view->viewport()->rect();
+        area |= view->mapToScene(viewportRect).boundingRect();
+    }
+
+    return area;
+}
+
 /**
  * Enables the selected tool at this map scene.
  * Therefore it tells that tool, that this is the active map scene.
@@ -263,6 +410,17 @@ void MapScene::repaintTileset(Tileset *tileset)
     }
 }
 
+/**
+ * Repaints only the parts of the maps that show any of the given \a tiles,
+ * which changed as a result of playing tile animations.
+ */
+void MapScene::repaintTiles(Tileset *tileset, const QList<Tile*> &tiles)
+{
+    for (MapItem *mapItem : qAsConst(mMapItems))
+        if (contains(mapItem->mapDocument()->map()->tilesets(), tileset))
+            mapItem->repaintTiles(tileset, tiles);
+}
+
 /**
  * A layer has changed. This can mean that the layer visibility, opacity or
  * offset changed.
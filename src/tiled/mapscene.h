@@ -28,6 +28,7 @@
 #include <QColor>
 #include <QGraphicsScene>
 #include <QHash>
+#include <QTimer>
 
 namespace Tiled {
 
@@ -46,6 +47,7 @@ class MapDocument;
 class MapObjectItem;
 class MapScene;
 class MapItem;
+class MapPlaceholderItem;
 class ObjectGroupItem;
 
 /**
@@ -61,12 +63,15 @@ public:
 
     MapDocument *mapDocument() const;
     void setMapDocument(MapDocument *map);
+    MapItem *mapItem(MapDocument *mapDocument) const;
 
     void enableSelectedTool();
     void disableSelectedTool();
 
     void setSelectedTool(AbstractTool *tool);
 
+    void viewportChanged();
+
 protected:
     void drawForeground(QPainter *painter, const QRectF &rect) override;
 
@@ -92,6 +97,7 @@ private slots:
 
     void mapChanged();
     void repaintTileset(Tileset *tileset);
+    void repaintTiles(Tileset *tileset, const QList<Tile*> &tiles);
 
     void layerChanged(Layer *);
 
@@ -104,10 +110,26 @@ private:
     void updateDefaultBackgroundColor();
     void updateSceneRect();
 
+    void updateContextMaps();
+    void addPlaceholder(const QString &fileName);
+    void loadContextMap(MapPlaceholderItem *placeholder);
+    void unloadContextMap(const QString &fileName);
+    QRectF visibleArea() const;
+
     bool eventFilter(QObject *object, QEvent *event) override;
 
     MapDocument *mMapDocument;
     QHash<MapDocument*, MapItem*> mMapItems;
+
+    // Other maps of the world are loaded one at a time on the GUI thread
+    // while they are near the visible area, and are shown as placeholders
+    // otherwise.
+    QPoint mCurrentMapPosition;
+    QHash<QString, QRect> mContextMapRects;
+    QHash<QString, MapItem*> mContextMapItems;
+    QHash<QString, MapPlaceholderItem*> mPlaceholders;
+    QTimer mContextMapTimer;
+
     AbstractTool *mSelectedTool;
     AbstractTool *mActiveTool;
     bool mGridVisible;
@@ -125,5 +147,13 @@ inline MapDocument *MapScene::mapDocument() const
     return mMapDocument;
 }
 
+/**
+ * Returns the item representing the given \a mapDocument, if any.
+ */
+inline MapItem *MapScene::mapItem(MapDocument *mapDocument) const
+{
+    return mMapItems.value(mapDocument);
+}
+
 } // namespace Internal
 } // namespace Tiled
@@ -79,6 +79,14 @@ MapView::MapView(QWidget *parent, Mode mode)
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
 
+    // Let the scene know when the visible area changed
+    auto viewportChanged = [this] {
+        if (MapScene *scene = mapScene())
+            scene->viewportChanged();
+    };
+    connect(horizontalScrollBar(), &QAbstractSlider::valueChanged, this, viewportChanged);
+    connect(verticalScrollBar(), &QAbstractSlider::valueChanged, this, viewportChanged);
+
     connect(mZoomable, &Zoomable::scaleChanged, this, &MapView::adjustScale);
 }
 
@@ -117,6 +125,9 @@ void MapView::adjustScale(qreal scale)
 
     setRenderHint(QPainter::SmoothPixmapTransform,
                   mZoomable->smoothTransform());
+
+    if (MapScene *scene = mapScene())
+        scene->viewportChanged();
 }
 
 void MapView::setUseOpenGL(bool useOpenGL)
@@ -261,6 +272,9 @@ void MapView::resizeEvent(QResizeEvent *event)
         updateSceneRect(s->sceneRect());
 
     QGraphicsView::resizeEvent(event);
+
+    if (MapScene *scene = mapScene())
+        scene->viewportChanged();
 }
 
 void MapView::keyPressEvent(QKeyEvent *event)
@@ -20,23 +20,300 @@
 
 #include "objectgroupitem.h"
 
+#include "mapdocument.h"
+#include "mapobject.h"
+#include "mapobjectitem.h"
+#include "maprenderer.h"
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "qtcompat_p.h"
+
+#include <algorithm>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+// The shapes drawn for objects can extend this far beyond their bounds, for
+// example the marker of point objects. Since outlines are drawn with a
+// cosmetic pen, the margin is divided by the scale when zoomed out.
+static const qreal ObjectMargin = 30;
+
+namespace {
+
+/**
+ * Collects unrotated rectangle objects of the same color, so they can be
+ * drawn using a single call. They look the same as when drawn by
+ * OrthogonalRenderer::drawMapObject.
+ */
+class RectangleBatch
+{
+public:
+    RectangleBatch(QPainter *painter, const MapRenderer *renderer)
+        : mPainter(painter)
+        , mRenderer(renderer)
+    {}
+
+    ~RectangleBatch() { flush(); }
+
+    void add(const QRectF &bounds, const QColor &color)
+    {
+        if (color != mColor)
+            flush();
+
+        mColor = color;
+
+        if (bounds.isNull())
+            mRects.append(QRectF(bounds.topLeft() - QPointF(10, 10), QSizeF(20, 20)));
+        else
+            mRects.append(bounds);
+    }
+
+    void flush()
+    {
+        if (mRects.isEmpty())
+            return;
+
+        const qreal lineWidth = mRenderer->objectLineWidth();
+        const qreal shadowDist = (lineWidth == 0 ? 1 : lineWidth) / mRenderer->painterScale();
+        const QPointF shadowOffset = QPointF(shadowDist * 0.5,
+                                             shadowDist * 0.5);
+
+        QPen linePen(mColor, lineWidth, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+        linePen.setCosmetic(true);
+        QPen shadowPen(linePen);
+        shadowPen.setColor(Qt::black);
+
+        QColor brushColor = mColor;
+        brushColor.setAlpha(50);
+
+        mPainter->save();
+        mPainter->setRenderHint(QPainter::Antialiasing);
+
+        mPainter->translate(shadowOffset);
+        mPainter->setPen(shadowPen);
+        mPainter->setBrush(Qt::NoBrush);
+        mPainter->drawRects(mRects);
+        mPainter->translate(-shadowOffset);
+
+        mPainter->setPen(linePen);
+        mPainter->setBrush(brushColor);
+        mPainter->drawRects(mRects);
+
+        mPainter->restore();
+        mRects.resize(0);
+    }
+
+private:
+    QPainter *mPainter;
+    const MapRenderer *mRenderer;
+    QVector<QRectF> mRects;
+    QColor mColor;
+};
+
+} // anonymous namespace
+
 ObjectGroupItem::ObjectGroupItem(ObjectGroup *objectGroup, QGraphicsItem *parent)
     : LayerItem(objectGroup, parent)
+    , mMapDocument(nullptr)
 {
-    // Since we don't do any painting, we can spare us the call to paint()
+    // Until batch rendering is enabled, we don't do any painting, so we can
+    // spare us the call to paint()
     setFlag(QGraphicsItem::ItemHasNoContents);
 }
 
+/**
+ * Enables drawing the objects of the group, using the renderer of the given
+ * \a mapDocument. Passing nullptr disables batch rendering.
+ *
+ * Batch rendering relies on the objects being in the same coordinates as
+ * this item, so it is only supported for orthogonal maps.
+ */
+void ObjectGroupItem::setBatchRendering(MapDocument *mapDocument)
+{
+    if (mMapDocument == mapDocument)
+        return;
+
+    mMapDocument = mapDocument;
+
+    setFlag(QGraphicsItem::ItemHasNoContents, mapDocument == nullptr);
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, mapDocument != nullptr);
+
+    syncWithObjectGroup();
+}
+
+/**
+ * Repaints the objects showing any of the given \a tiles from \a tileset,
+ * for example because their animation advanced.
+ */
+void ObjectGroupItem::repaintTiles(Tileset *tileset, const QSet<Tile*> &tiles)
+{
+    if (!mMapDocument)
+        return;
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+
+    for (const MapObject *object : objectGroup()->objects()) {
+        const Cell &cell = object->cell();
+        if (cell.tileset() == tileset && tiles.contains(cell.tile()))
+            update(renderer->boundingRect(object));
+    }
+}
+
+/**
+ * Recomputes the bounding rect from all objects and repaints them.
+ */
+void ObjectGroupItem::syncWithObjectGroup()
+{
+    QRectF boundingRect;
+
+    // The bounds of the objects may have changed without notice
+    mChangedObjectBounds.clear();
+
+    if (mMapDocument) {
+        const MapRenderer *renderer = mMapDocument->renderer();
+        for (const MapObject *object : objectGroup()->objects())
+            boundingRect |= renderer->boundingRect(object);
+    }
+
+    if (mBoundingRect != boundingRect) {
+        prepareGeometryChange();
+        mBoundingRect = boundingRect;
+    }
+
+    update();
+}
+
+/**
+ * Grows the bounding rect to include the given \a objects and repaints them.
+ *
+ * The bounds of changed objects are remembered, so that when they change
+ * again, for example while they are being moved, only their old and new
+ * bounds need to be repainted. The first time an object changes, its old
+ * bounds are unknown and the whole item is repainted.
+ */
+void ObjectGroupItem::objectsChanged(const QList<MapObject*> &objects)
+{
+    if (!mMapDocument)
+        return;
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+
+    QRectF boundingRect = mBoundingRect;
+    QRectF dirty;
+    bool dirtyAll = false;
+
+    for (MapObject *object : objects) {
+        const QRectF bounds = renderer->boundingRect(object);
+        boundingRect |= bounds;
+
+        auto it = mChangedObjectBounds.find(object);
+        if (it == mChangedObjectBounds.end()) {
+            dirtyAll = true;
+            mChangedObjectBounds.insert(object, bounds);
+        } else {
+            dirty |= it.value() | bounds;
+            it.value() = bounds;
+        }
+    }
+
+    if (mBoundingRect != boundingRect) {
+        prepareGeometryChange();
+        mBoundingRect = boundingRect;
+    }
+
+    if (dirtyAll)
+        update();
+    else
+        update(dirty);
+}
+
+/**
+ * Forgets about the given removed \a objects and repaints.
+ */
+void ObjectGroupItem::objectsRemoved(const QList<MapObject*> &objects)
+{
+    for (MapObject *object : objects)
+        mChangedObjectBounds.remove(object);
+
+    if (mMapDocument)
+        update();
+}
+
 QRectF ObjectGroupItem::boundingRect() const
 {
-    return QRectF();
+    return mBoundingRect;
 }
 
-void ObjectGroupItem::paint(QPainter *,
-                            const QStyleOptionGraphicsItem *,
+void ObjectGroupItem::paint(QPainter *painter,
+                            const QStyleOptionGraphicsItem *option,
                             QWidget *)
 {
+    if (!mMapDocument)
+        return;
+
+    MapRenderer *renderer = mMapDocument->renderer();
+    renderer->setPainterScale(option->levelOfDetailFromTransform(painter->worldTransform()));
+
+    const qreal margin = ObjectMargin / qMin<qreal>(1, renderer->painterScale());
+    const QRectF exposed = option->exposedRect.adjusted(-margin, -margin,
+                                                        margin, margin);
+    QList<MapObject*> objects = objectGroup()->objectsInRect(exposed);
+
+    // Match the stacking order used for the object items
+    if (objectGroup()->drawOrder() == ObjectGroup::TopDownOrder) {
+        std::stable_sort(objects.begin(), objects.end(),
+                         [] (const MapObject *a, const MapObject *b) {
+            return a->y() < b->y();
+        });
+    }
+
+    const bool showTileObjectOutlines = renderer->testFlag(ShowTileObjectOutlines);
+
+    // Consecutive tile objects using the same tile are drawn with a single
+    // call by the CellRenderer, and rectangles of the same color by the
+    // RectangleBatch. Other objects are drawn one by one.
+    CellRenderer cellRenderer(painter);
+    RectangleBatch rectangles(painter, renderer);
+
+    for (MapObject *object : qAsConst(objects)) {
+        if (!object->isVisible())
+            continue;
+
+        const bool rotated = object->rotation() != 0.0;
+
+        if (!rotated && !object->cell().isEmpty() && !showTileObjectOutlines) {
+            rectangles.flush();
+            cellRenderer.render(object->cell(), object->position(), object->size(),
+                                CellRenderer::BottomLeft);
+            continue;
+        }
+
+        cellRenderer.flush();
+
+        const QColor color = MapObjectItem::objectColor(object);
+
+        if (!rotated && object->cell().isEmpty() && object->shape() == MapObject::Rectangle) {
+            rectangles.add(object->bounds(), color);
+            continue;
+        }
+
+        rectangles.flush();
+
+        painter->save();
+
+        if (rotated) {
+            const QPointF pos = renderer->pixelToScreenCoords(object->position());
+            painter->translate(pos);
+            painter->rotate(object->rotation());
+            painter->translate(-pos);
+        }
+
+        renderer->drawMapObject(painter, object, color);
+        painter->restore();
+    }
+
+    cellRenderer.flush();
+    rectangles.flush();
 }
@@ -24,13 +24,21 @@
 
 #include "objectgroup.h"
 
+#include <QHash>
+#include <QSet>
+
 namespace Tiled {
 namespace Internal {
 
+class MapDocument;
+
 /**
- * A graphics item representing an object group in a QGraphicsView. It only
+ * A graphics item representing an object group in a QGraphicsView. It
  * serves to group together the objects belonging to the same object group.
  *
+ * When batch rendering is enabled, it draws all objects of the group in a
+ * single paint, instead of having a MapObjectItem for each object.
+ *
  * @see MapObjectItem
  */
 class ObjectGroupItem : public LayerItem
@@ -40,11 +48,25 @@ public:
 
     ObjectGroup *objectGroup() const;
 
+    void setBatchRendering(MapDocument *mapDocument);
+    bool isBatchRendering() const;
+
+    void repaintTiles(Tileset *tileset, const QSet<Tile*> &tiles);
+
+    void syncWithObjectGroup();
+    void objectsChanged(const QList<MapObject*> &objects);
+    void objectsRemoved(const QList<MapObject*> &objects);
+
     // QGraphicsItem
     QRectF boundingRect() const override;
     void paint(QPainter *painter,
                const QStyleOptionGraphicsItem *option,
                QWidget *widget = nullptr) override;
+
+private:
+    MapDocument *mMapDocument;
+    QHash<MapObject*, QRectF> mChangedObjectBounds;
+    QRectF mBoundingRect;
 };
 
 inline ObjectGroup *ObjectGroupItem::objectGroup() const
@@ -52,5 +74,10 @@ inline ObjectGroup *ObjectGroupItem::objectGroup() const
     return static_cast<ObjectGroup*>(layer());
 }
 
+inline bool ObjectGroupItem::isBatchRendering() const
+{
+    return mMapDocument != nullptr;
+}
+
 } // namespace Internal
 } // namespace Tiled
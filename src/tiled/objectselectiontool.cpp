@@ -26,6 +26,7 @@
 #include "layer.h"
 #include "map.h"
 #include "mapdocument.h"
+#include "mapitem.h"
 #include "mapobject.h"
 #include "mapobjectitem.h"
 #include "mapobjectmodel.h"
@@ -1091,13 +1092,18 @@ void ObjectSelectionTool::updateSelection(const QPointF &pos,
 
     QList<MapObject*> selectedObjects;
 
-    const QList<QGraphicsItem *> &items = mapScene()->items(rect);
-    for (QGraphicsItem *item : items) {
-        if (!item->isEnabled())
-            continue;
-        MapObjectItem *mapObjectItem = qgraphicsitem_cast<MapObjectItem*>(item);
-        if (mapObjectItem && mapObjectItem->mapObject()->objectGroup()->isUnlocked())
-            selectedObjects.append(mapObjectItem->mapObject());
+    MapItem *mapItem = mapScene()->mapItem(mapDocument());
+    if (mapItem && mapItem->canFindObjectsInRect()) {
+        selectedObjects = mapItem->objectsInRect(rect);
+    } else {
+        const QList<QGraphicsItem *> &items = mapScene()->items(rect);
+        for (QGraphicsItem *item : items) {
+            if (!item->isEnabled())
+                continue;
+            MapObjectItem *mapObjectItem = qgraphicsitem_cast<MapObjectItem*>(item);
+            if (mapObjectItem && mapObjectItem->mapObject()->objectGroup()->isUnlocked())
+                selectedObjects.append(mapObjectItem->mapObject());
+        }
     }
 
     if (modifiers & (Qt::ControlModifier | Qt::ShiftModifier)) {
@@ -26,10 +26,76 @@
 #include "tilepainter.h"
 
 #include <QCoreApplication>
+#include <QSet>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+/**
+ * Copies the cells within \a region from the layer \a from to the layer
+ * \a to. The region is in the coordinates of \a to, and \a offset is the
+ * position of \a from within those coordinates.
+ */
+static void copyCells(TileLayer *to, const TileLayer *from,
+                      const QRegion &region, const QPoint &offset)
+{
+#if QT_VERSION >= 0x050800
+    for (const QRect &rect : region)
+#else
+    const auto rects = region.rects();
+    for (const QRect &rect : rects)
+#endif
+        for (int y = rect.top(); y <= rect.bottom(); ++y)
+            for (int x = rect.left(); x <= rect.right(); ++x)
+                to->setCell(x, y, from->cellAt(x - offset.x(), y - offset.y()));
+}
+
+/**
+ * Stores the cells within \a region from the layer \a from in the layer
+ * \a to, which use the same coordinates.
+ *
+ * Chunks that are not yet present in \a to and do not intersect the region
+ * to \a keep are shared as a whole, which avoids copying any cells.
+ */
+static void shareCells(TileLayer *to, const TileLayer *from,
+                       const QRegion &region, const QRegion &keep)
+{
+    QSet<QPoint> sharedChunks;
+
+#if QT_VERSION >= 0x050800
+    for (const QRect &rect : region) {
+#else
+    const auto rects = region.rects();
+    for (const QRect &rect : rects) {
+#endif
+        const int startX = rect.left() - (rect.left() & CHUNK_MASK);
+        const int startY = rect.top() - (rect.top() & CHUNK_MASK);
+
+        for (int chunkY = startY; chunkY <= rect.bottom(); chunkY += CHUNK_SIZE) {
+            for (int chunkX = startX; chunkX <= rect.right(); chunkX += CHUNK_SIZE) {
+                const QRect chunkRect(chunkX, chunkY, CHUNK_SIZE, CHUNK_SIZE);
+                const QPoint chunkKey(chunkX, chunkY);
+
+                if (sharedChunks.contains(chunkKey))
+                    continue;
+
+                if (!to->findChunk(chunkX, chunkY) && !keep.intersects(chunkRect)) {
+                    // A missing chunk has only empty cells in either layer
+                    if (const Chunk *chunk = from->findChunk(chunkX, chunkY))
+                        to->setChunk(chunkX, chunkY, *chunk);
+                    sharedChunks.insert(chunkKey);
+                    continue;
+                }
+
+                const QRect r = chunkRect & rect;
+                for (int y = r.top(); y <= r.bottom(); ++y)
+                    for (int x = r.left(); x <= r.right(); ++x)
+                        to->setCell(x, y, from->cellAt(x, y));
+            }
+        }
+    }
+}
+
 PaintTileLayer::PaintTileLayer(MapDocument *mapDocument,
                                TileLayer *target,
                                int x,
@@ -55,16 +121,18 @@ PaintTileLayer::PaintTileLayer(MapDocument *mapDocument,
     : QUndoCommand(parent)
     , mMapDocument(mapDocument)
     , mMergeable(false)
+    , mCollapsed(false)
 {
     auto &data = mLayerData[target];
 
-    data.mSource = source->clone();
-    data.mErased = target->copy(x - target->x(),
-                                y - target->y(),
-                                source->width(), source->height());
-    data.mX = x;
-    data.mY = y;
-    data.mPaintedRegion = paintRegion;
+    data.mSource = new TileLayer(QString(), 0, 0, target->width(), target->height());
+    data.mErased = new TileLayer(QString(), 0, 0, target->width(), target->height());
+    data.mOffset = target->position();
+    data.mPaintedRegion = paintRegion & QRect(x, y, source->width(), source->height());
+
+    const QRegion region = data.mPaintedRegion.translated(-data.mOffset);
+    copyCells(data.mSource, source, region, QPoint(x, y) - data.mOffset);
+    shareCells(data.mErased, target, region, QRegion());
 
     setText(QCoreApplication::translate("Undo Commands", "Paint"));
 }
@@ -79,11 +147,13 @@ PaintTileLayer::~PaintTileLayer()
 
 void PaintTileLayer::undo()
 {
-    QHashIterator<TileLayer*, LayerData> it(mLayerData);
-    while (it.hasNext()) {
-        const LayerData &data = it.next().value();
-        TilePainter painter(mMapDocument, it.key());
-        painter.setCells(data.mX, data.mY, data.mErased, data.mPaintedRegion);
+    if (!mCollapsed) {
+        QHashIterator<TileLayer*, LayerData> it(mLayerData);
+        while (it.hasNext()) {
+            const LayerData &data = it.next().value();
+            TilePainter painter(mMapDocument, it.key());
+            painter.copyCells(data.mErased, data.mPaintedRegion);
+        }
     }
 
     QUndoCommand::undo(); // undo child commands
@@ -93,11 +163,14 @@ void PaintTileLayer::redo()
 {
     QUndoCommand::redo(); // redo child commands
 
+    if (mCollapsed)
+        return;
+
     QHashIterator<TileLayer*, LayerData> it(mLayerData);
     while (it.hasNext()) {
         const LayerData &data = it.next().value();
         TilePainter painter(mMapDocument, it.key());
-        painter.setCells(data.mX, data.mY, data.mSource, data.mPaintedRegion);
+        painter.copyCells(data.mSource, data.mPaintedRegion);
     }
 }
 
@@ -106,44 +179,25 @@ void PaintTileLayer::LayerData::mergeWith(const PaintTileLayer::LayerData &o)
     if (!mSource) {
         mSource = o.mSource->clone();
         mErased = o.mErased->clone();
-        mX = o.mX;
-        mY = o.mY;
+        mOffset = o.mOffset;
         mPaintedRegion = o.mPaintedRegion;
         return;
     }
 
-    const QRegion newRegion = o.mPaintedRegion.subtracted(mPaintedRegion);
-    const QRegion combinedRegion = mPaintedRegion.united(o.mPaintedRegion);
-    const QRect bounds = QRect(mX, mY, mSource->width(), mSource->height());
-    const QRect combinedBounds = combinedRegion.boundingRect();
-
-    // Resize the erased tiles and source layers when necessary
-    if (bounds != combinedBounds) {
-        const QPoint shift = bounds.topLeft() - combinedBounds.topLeft();
-        mErased->resize(combinedBounds.size(), shift);
-        mSource->resize(combinedBounds.size(), shift);
-    }
+    // Only consecutive commands are merged, so the layer can't have moved
+    Q_ASSERT(mOffset == o.mOffset);
 
-    mX = combinedBounds.left();
-    mY = combinedBounds.top();
-    mPaintedRegion = combinedRegion;
+    const QRegion newRegion = o.mPaintedRegion.subtracted(mPaintedRegion);
 
     // Copy the painted tiles from the other command over
-    const QPoint pos = QPoint(o.mX, o.mY) - combinedBounds.topLeft();
-    mSource->merge(pos, o.mSource);
+    copyCells(mSource, o.mSource, o.mPaintedRegion.translated(-mOffset), QPoint());
 
     // Copy the newly erased tiles from the other command over
-#if QT_VERSION >= 0x050800
-    for (const QRect &rect : newRegion)
-#else
-    const auto rects = newRegion.rects();
-    for (const QRect &rect : rects)
-#endif
-        for (int y = rect.top(); y <= rect.bottom(); ++y)
-            for (int x = rect.left(); x <= rect.right(); ++x)
-                mErased->setCell(x - mX,
-                                 y - mY,
-                                 o.mErased->cellAt(x - o.mX, y - o.mY));
+    shareCells(mErased, o.mErased,
+               newRegion.translated(-mOffset),
+               mPaintedRegion.translated(-mOffset));
+
+    mPaintedRegion |= o.mPaintedRegion;
 }
 
 bool PaintTileLayer::mergeWith(const QUndoCommand *other)
@@ -151,6 +205,8 @@ bool PaintTileLayer::mergeWith(const QUndoCommand *other)
     const PaintTileLayer *o = static_cast<const PaintTileLayer*>(other);
     if (!(mMapDocument == o->mMapDocument && o->mMergeable))
         return false;
+    if (mCollapsed || o->mCollapsed)
+        return false;
     if (!cloneChildren(other, this))
         return false;
 
@@ -162,3 +218,34 @@ bool PaintTileLayer::mergeWith(const QUndoCommand *other)
 
     return true;
 }
+
+qint64 PaintTileLayer::memoryUsage() const
+{
+    const qint64 chunkUsage = sizeof(Chunk) + CHUNK_SIZE * CHUNK_SIZE * sizeof(quint32);
+
+    qint64 usage = 0;
+    for (const LayerData &data : mLayerData) {
+        if (data.mSource)
+            usage += data.mSource->chunks().size() * chunkUsage;
+        if (data.mErased)
+            usage += data.mErased->chunks().size() * chunkUsage;
+    }
+
+    return usage;
+}
+
+/**
+ * Releases the painted and erased cells. Afterwards, undoing or redoing
+ * this command only affects its child commands.
+ */
+void PaintTileLayer::collapse()
+{
+    for (LayerData &data : mLayerData) {
+        delete data.mSource;
+        delete data.mErased;
+        data.mSource = nullptr;
+        data.mErased = nullptr;
+    }
+
+    mCollapsed = true;
+}
@@ -36,8 +36,12 @@ class MapDocument;
 
 /**
  * A command that paints one tile layer on top of another tile layer.
+ *
+ * The painted and erased cells are stored sparsely, in the chunks touched by
+ * the painted region. Erased chunks share their data with the target layer
+ * until it is changed.
  */
-class PaintTileLayer : public QUndoCommand
+class PaintTileLayer : public QUndoCommand, public CollapsibleUndoCommand
 {
 public:
     /**
@@ -85,20 +89,25 @@ public:
     int id() const override { return Cmd_PaintTileLayer; }
     bool mergeWith(const QUndoCommand *other) override;
 
+    qint64 memoryUsage() const override;
+    void collapse() override;
+
 private:
     struct LayerData
     {
         void mergeWith(const LayerData &o);
 
+        // Both layers use the coordinates of the target layer
         TileLayer *mSource = nullptr;
         TileLayer *mErased = nullptr;
-        int mX, mY;
-        QRegion mPaintedRegion;
+        QPoint mOffset;             // Position of the target layer
+        QRegion mPaintedRegion;     // In map coordinates
     };
 
     MapDocument *mMapDocument;
     QHash<TileLayer*, LayerData> mLayerData;
     bool mMergeable;
+    bool mCollapsed;
 };
 
 inline void PaintTileLayer::setMergeable(bool mergeable)
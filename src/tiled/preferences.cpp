@@ -83,8 +83,12 @@ Preferences::Preferences()
     mObjectLineWidth = realValue("ObjectLineWidth", 2);
     mHighlightCurrentLayer = boolValue("HighlightCurrentLayer");
     mShowTilesetGrid = boolValue("ShowTilesetGrid", true);
+    mTileRenderCacheSize = qMax(0, intValue("TileRenderCacheSize", 128));
+    mImageCacheSize = qMax(0, intValue("ImageCacheSize", 512));
+    mUndoMemoryLimit = qMax(0, intValue("UndoMemoryLimit", 512));
     mLanguage = stringValue("Language");
     mUseOpenGL = boolValue("OpenGL");
+    mBatchObjectRendering = boolValue("BatchObjectRendering");
     mWheelZoomsByDefault = boolValue("WheelZoomsByDefault");
     mObjectLabelVisibility = static_cast<ObjectLabelVisiblity>
             (intValue("ObjectLabelVisibility", AllObjectLabels));
@@ -131,6 +135,7 @@ Preferences::Preferences()
 
     mSettings->beginGroup(QLatin1String("Automapping"));
     mAutoMapDrawing = boolValue("WhileDrawing");
+    mAutoMapParallel = boolValue("Parallel", true);
     mSettings->endGroup();
 
     mSettings->beginGroup(QLatin1String("MapsDirectory"));
@@ -444,6 +449,31 @@ void Preferences::setUseOpenGL(bool useOpenGL)
     emit useOpenGLChanged(mUseOpenGL);
 }
 
+void Preferences::setBatchObjectRendering(bool enabled)
+{
+    if (mBatchObjectRendering == enabled)
+        return;
+
+    mBatchObjectRendering = enabled;
+    mSettings->setValue(QLatin1String("Interface/BatchObjectRendering"),
+                        mBatchObjectRendering);
+
+    emit batchObjectRenderingChanged(mBatchObjectRendering);
+}
+
+void Preferences::setTileRenderCacheSize(int megabytes)
+{
+    megabytes = qMax(0, megabytes);
+    if (mTileRenderCacheSize == megabytes)
+        return;
+
+    mTileRenderCacheSize = megabytes;
+    mSettings->setValue(QLatin1String("Interface/TileRenderCacheSize"),
+                        mTileRenderCacheSize);
+
+    emit tileRenderCacheSizeChanged(mTileRenderCacheSize);
+}
+
 void Preferences::setObjectTypes(const ObjectTypes &objectTypes)
 {
     Object::setObjectTypes(objectTypes);
@@ -523,6 +553,12 @@ void Preferences::setAutomappingDrawing(bool enabled)
     mSettings->setValue(QLatin1String("Automapping/WhileDrawing"), enabled);
 }
 
+void Preferences::setAutomappingParallel(bool enabled)
+{
+    mAutoMapParallel = enabled;
+    mSettings->setValue(QLatin1String("Automapping/Parallel"), enabled);
+}
+
 QString Preferences::mapsDirectory() const
 {
     return mMapsDirectory;
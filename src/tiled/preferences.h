@@ -58,6 +58,26 @@ public:
     bool highlightCurrentLayer() const { return mHighlightCurrentLayer; }
     bool showTilesetGrid() const { return mShowTilesetGrid; }
 
+    /**
+     * The amount of memory in megabytes used for caching pre-rendered tile
+     * layer chunks. 0 disables the cache.
+     */
+    int tileRenderCacheSize() const { return mTileRenderCacheSize; }
+    void setTileRenderCacheSize(int megabytes);
+
+    /**
+     * The amount of memory in megabytes used for caching loaded images and
+     * tiles. 0 disables the cache.
+     */
+    int imageCacheSize() const { return mImageCacheSize; }
+
+    /**
+     * The amount of memory in megabytes the undo history of a map may use
+     * for painted tiles, before the oldest steps are dropped. 0 means there
+     * is no limit.
+     */
+    int undoMemoryLimit() const { return mUndoMemoryLimit; }
+
     enum ObjectLabelVisiblity {
         NoObjectLabels,
         SelectedObjectLabels,
@@ -106,6 +126,9 @@ public:
     bool useOpenGL() const { return mUseOpenGL; }
     void setUseOpenGL(bool useOpenGL);
 
+    bool batchObjectRendering() const { return mBatchObjectRendering; }
+    void setBatchObjectRendering(bool enabled);
+
     void setObjectTypes(const ObjectTypes &objectTypes);
 
     enum FileType {
@@ -121,6 +144,7 @@ public:
     void setLastPath(FileType fileType, const QString &path);
 
     bool automappingDrawing() const { return mAutoMapDrawing; }
+    bool automappingParallel() const { return mAutoMapParallel; }
 
     QString mapsDirectory() const;
     void setMapsDirectory(const QString &path);
@@ -174,6 +198,7 @@ public slots:
     void setHighlightCurrentLayer(bool highlight);
     void setShowTilesetGrid(bool showTilesetGrid);
     void setAutomappingDrawing(bool enabled);
+    void setAutomappingParallel(bool enabled);
     void setOpenLastFilesOnStartup(bool load);
     void setPluginEnabled(const QString &fileName, bool enabled);
     void setWheelZoomsByDefault(bool mode);
@@ -200,6 +225,8 @@ signals:
     void selectionColorChanged(const QColor &selectionColor);
 
     void useOpenGLChanged(bool useOpenGL);
+    void batchObjectRenderingChanged(bool enabled);
+    void tileRenderCacheSizeChanged(int megabytes);
 
     void languageChanged();
 
@@ -238,6 +265,9 @@ private:
     qreal mObjectLineWidth;
     bool mHighlightCurrentLayer;
     bool mShowTilesetGrid;
+    int mTileRenderCacheSize;
+    int mImageCacheSize;
+    int mUndoMemoryLimit;
     bool mOpenLastFilesOnStartup;
     ObjectLabelVisiblity mObjectLabelVisibility;
     bool mLabelForHoveredObject;
@@ -252,8 +282,10 @@ private:
     QString mLanguage;
     bool mReloadTilesetsOnChange;
     bool mUseOpenGL;
+    bool mBatchObjectRendering;
 
     bool mAutoMapDrawing;
+    bool mAutoMapParallel;
 
     QString mMapsDirectory;
     QString mStampsDirectory;
@@ -31,6 +31,7 @@
 #include "changetileimagesource.h"
 #include "changetileprobability.h"
 #include "changewangsetdata.h"
+#include "compression.h"
 #include "changewangcolordata.h"
 #include "flipmapobjects.h"
 #include "imagelayer.h"
@@ -354,11 +355,9 @@ static QVariant predefinedPropertyValue(Object *object, const QString &name)
     if (objectType.isEmpty())
         return QVariant();
 
-    for (const ObjectType &type : Object::objectTypes()) {
-        if (type.name == objectType)
-            if (type.defaultProperties.contains(name))
-                return type.defaultProperties.value(name);
-    }
+    const Properties properties = Object::objectTypeProperties(objectType);
+    if (properties.contains(name))
+        return properties.value(name);
 
     return QVariant();
 }
@@ -593,6 +592,11 @@ void PropertyBrowser::addMapProperties()
 
     layerFormatProperty->setAttribute(QLatin1String("enumNames"), mLayerFormatNames);
 
+    QtVariantProperty *compressionLevelProperty =
+            addProperty(CompressionLevelProperty, QVariant::Int, tr("Compression Level"), groupProperty);
+
+    compressionLevelProperty->setAttribute(QLatin1String("minimum"), -1);
+
     QtVariantProperty *renderOrderProperty =
             addProperty(RenderOrderProperty,
                         QtVariantPropertyManager::enumTypeId(),
@@ -964,6 +968,11 @@ void PropertyBrowser::applyMapValue(PropertyId id, const QVariant &val)
         command = new ChangeMapProperty(mMapDocument, format);
         break;
     }
+    case CompressionLevelProperty: {
+        command = new ChangeMapProperty(mMapDocument, ChangeMapProperty::CompressionLevel,
+                                        val.toInt());
+        break;
+    }
     case RenderOrderProperty: {
         Map::RenderOrder renderOrder = static_cast<Map::RenderOrder>(val.toInt());
         command = new ChangeMapProperty(mMapDocument, renderOrder);
@@ -1538,6 +1547,7 @@ void PropertyBrowser::updateProperties()
         mIdToProperty[StaggerAxisProperty]->setValue(map->staggerAxis());
         mIdToProperty[StaggerIndexProperty]->setValue(map->staggerIndex());
         mIdToProperty[LayerFormatProperty]->setValue(map->layerDataFormat());
+        mIdToProperty[CompressionLevelProperty]->setValue(map->compressionLevel());
         mIdToProperty[RenderOrderProperty]->setValue(map->renderOrder());
         mIdToProperty[BackgroundColorProperty]->setValue(map->backgroundColor());
         break;
@@ -1765,15 +1775,11 @@ void PropertyBrowser::updateCustomProperties()
 
     if (!objectType.isEmpty()) {
         // Inherit properties from the object type
-        for (const ObjectType &type : Object::objectTypes()) {
-            if (type.name == objectType) {
-                QMapIterator<QString,QVariant> it(type.defaultProperties);
-                while (it.hasNext()) {
-                    it.next();
-                    if (!mCombinedProperties.contains(it.key()))
-                        mCombinedProperties.insert(it.key(), it.value());
-                }
-            }
+        QMapIterator<QString,QVariant> it(Object::objectTypeProperties(objectType));
+        while (it.hasNext()) {
+            it.next();
+            if (!mCombinedProperties.contains(it.key()))
+                mCombinedProperties.insert(it.key(), it.value());
         }
     }
 
@@ -1864,6 +1870,8 @@ void PropertyBrowser::retranslateUi()
     mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (gzip compressed)"));
     mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (zlib compressed)"));
     mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "CSV"));
+    if (compressionSupported(Zstandard))
+        mLayerFormatNames.append(QCoreApplication::translate("PreferencesDialog", "Base64 (Zstandard compressed)"));
 
     mRenderOrderNames.append(QCoreApplication::translate("PreferencesDialog", "Right Down"));
     mRenderOrderNames.append(QCoreApplication::translate("PreferencesDialog", "Right Up"));
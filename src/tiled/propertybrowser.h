@@ -144,6 +144,7 @@ private:
         StaggerIndexProperty,
         RenderOrderProperty,
         LayerFormatProperty,
+        CompressionLevelProperty,
         ImageSourceProperty,
         TilesetImageParametersProperty,
         FlippingProperty,
@@ -13,7 +13,7 @@ win32 {
     DESTDIR = ../../bin
 }
 
-QT += widgets
+QT += widgets concurrent
 
 contains(QT_CONFIG, opengl):!macx:!minQtVersion(5, 4, 0) {
     QT += opengl
@@ -161,6 +161,7 @@ SOURCES += aboutdialog.cpp \
     mapitem.cpp \
     mapobjectitem.cpp \
     mapobjectmodel.cpp \
+    mapplaceholderitem.cpp \
     mapscene.cpp \
     mapsdock.cpp \
     mapview.cpp \
@@ -357,6 +358,7 @@ HEADERS += aboutdialog.h \
     mapitem.h \
     mapobjectitem.h \
     mapobjectmodel.h \
+    mapplaceholderitem.h \
     mapscene.h \
     mapsdock.h \
     mapview.h \
@@ -24,22 +24,79 @@
 #include "map.h"
 #include "mapdocument.h"
 #include "maprenderer.h"
+#include "preferences.h"
+#include "tileset.h"
 
+#include "qtcompat_p.h"
+
+#include <QCache>
 #include <QPainter>
+#include <QPixmap>
 #include <QStyleOptionGraphicsItem>
+#include <QtMath>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace {
+
+/**
+ * Identifies a pre-rendered chunk of a tile layer at a certain scale.
+ */
+struct ChunkImageKey
+{
+    const TileLayerItem *item;
+    QPoint chunk;
+    int scale;      // in thousandths, including the device pixel ratio
+};
+
+inline bool operator==(const ChunkImageKey &a, const ChunkImageKey &b)
+{
+    return a.item == b.item && a.chunk == b.chunk && a.scale == b.scale;
+}
+
+inline uint qHash(const ChunkImageKey &key, uint seed = 0)
+{
+    return ::qHash(key.item, seed) ^ ::qHash(key.chunk.x() * 31 + key.chunk.y(), seed) ^ ::qHash(key.scale, seed);
+}
+
+/**
+ * The chunk images of all tile layers share a single cache, so that the
+ * memory used is bounded regardless of the number of layers and maps. The
+ * cost of each image is its size in kilobytes. The limit follows the tile
+ * render cache size preference.
+ */
+QCache<ChunkImageKey, QPixmap> &chunkImageCache()
+{
+    Preferences *prefs = Preferences::instance();
+    static QCache<ChunkImageKey, QPixmap> cache(prefs->tileRenderCacheSize() * 1024);
+    static const QMetaObject::Connection connection =
+            QObject::connect(prefs, &Preferences::tileRenderCacheSizeChanged,
+                             [] (int megabytes) { cache.setMaxCost(megabytes * 1024); });
+    Q_UNUSED(connection)
+    return cache;
+}
+
+// Larger chunk images are not cached, since few tiles are visible anyway
+const int MaxChunkImageSize = 2048;
+
+} // anonymous namespace
+
 TileLayerItem::TileLayerItem(TileLayer *layer, MapDocument *mapDocument, QGraphicsItem *parent)
     : LayerItem(layer, parent)
     , mMapDocument(mapDocument)
+    , mAnimatedTilesDirty(true)
 {
     setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
 
     syncWithTileLayer();
 }
 
+TileLayerItem::~TileLayerItem()
+{
+    removeCachedChunks();
+}
+
 void TileLayerItem::syncWithTileLayer()
 {
     prepareGeometryChange();
@@ -59,6 +116,151 @@ void TileLayerItem::syncWithTileLayer()
                                           margins.bottom());
 }
 
+/**
+ * Marks the index of animated tiles and the cached chunk images as out of
+ * date. The index will be rebuilt the next time any tiles need to be
+ * repainted.
+ */
+void TileLayerItem::invalidateChunks()
+{
+    mAnimatedTilesDirty = true;
+    mDirtyChunks.clear();
+    removeCachedChunks();
+}
+
+/**
+ * Marks the index of animated tiles and the cached chunk images as out of
+ * date for the chunks touching the given \a region, which is in layer
+ * coordinates.
+ */
+void TileLayerItem::invalidateChunks(const QRegion &region)
+{
+    if (region.isEmpty())
+        return;
+
+    auto chunkCoordinate = [] (int v) {
+        return v < 0 ? (v + 1) / CHUNK_SIZE - 1 : v / CHUNK_SIZE;
+    };
+
+    QSet<QPoint> chunks;
+
+#if QT_VERSION < 0x050800
+    const auto rects = region.rects();
+    for (const QRect &rect : rects) {
+#else
+    for (const QRect &rect : region) {
+#endif
+        for (int y = chunkCoordinate(rect.top()); y <= chunkCoordinate(rect.bottom()); ++y)
+            for (int x = chunkCoordinate(rect.left()); x <= chunkCoordinate(rect.right()); ++x)
+                chunks.insert(QPoint(x, y));
+    }
+
+    removeCachedChunks(chunks);
+
+    if (!mAnimatedTilesDirty)
+        mDirtyChunks.unite(chunks);
+}
+
+/**
+ * Repaints the chunks of this layer that use any of the given \a tiles.
+ */
+void TileLayerItem::repaintTiles(const QSet<Tile*> &tiles)
+{
+    updateAnimatedTiles();
+
+    if (mAnimatedTileChunks.isEmpty())
+        return;
+
+    QSet<QPoint> chunks;
+    for (Tile *tile : tiles) {
+        auto it = mAnimatedTileChunks.constFind(tile);
+        if (it != mAnimatedTileChunks.constEnd())
+            chunks.unite(it.value());
+    }
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins margins = mMapDocument->map()->drawMargins();
+    const QPoint layerPosition = tileLayer()->position();
+
+    for (const QPoint &chunk : qAsConst(chunks)) {
+        const QRect rect(chunk.x() * CHUNK_SIZE + layerPosition.x(),
+                         chunk.y() * CHUNK_SIZE + layerPosition.y(),
+                         CHUNK_SIZE, CHUNK_SIZE);
+
+        QRectF boundingRect = renderer->boundingRect(rect);
+        boundingRect.adjust(-margins.left(),
+                            -margins.top(),
+                            margins.right(),
+                            margins.bottom());
+
+        update(boundingRect);
+    }
+}
+
+void TileLayerItem::updateAnimatedTiles()
+{
+    const TileLayer *layer = tileLayer();
+
+    if (mAnimatedTilesDirty) {
+        mAnimatedTilesDirty = false;
+        mAnimatedTileChunks.clear();
+        mAnimatedChunks.clear();
+
+        // Avoid looking at the cells when none of the used tilesets animate
+        bool usesAnimatedTiles = false;
+        for (const SharedTileset &tileset : layer->usedTilesets()) {
+            if (!tileset->animatedTiles().isEmpty()) {
+                usesAnimatedTiles = true;
+                break;
+            }
+        }
+
+        if (!usesAnimatedTiles)
+            return;
+
+        const auto &chunks = layer->chunks();
+        for (auto it = chunks.begin(), end = chunks.end(); it != end; ++it)
+            indexAnimatedTiles(it.key(), it.value());
+
+        for (const QSet<QPoint> &tileChunks : qAsConst(mAnimatedTileChunks))
+            mAnimatedChunks.unite(tileChunks);
+
+        return;
+    }
+
+    if (mDirtyChunks.isEmpty())
+        return;
+
+    for (auto it = mAnimatedTileChunks.begin(); it != mAnimatedTileChunks.end(); ) {
+        it.value().subtract(mDirtyChunks);
+        if (it.value().isEmpty())
+            it = mAnimatedTileChunks.erase(it);
+        else
+            ++it;
+    }
+
+    for (const QPoint &chunkCoordinates : qAsConst(mDirtyChunks)) {
+        if (const Chunk *chunk = layer->findChunk(chunkCoordinates.x() * CHUNK_SIZE,
+                                                  chunkCoordinates.y() * CHUNK_SIZE))
+            indexAnimatedTiles(chunkCoordinates, *chunk);
+    }
+
+    mDirtyChunks.clear();
+
+    mAnimatedChunks.clear();
+    for (const QSet<QPoint> &tileChunks : qAsConst(mAnimatedTileChunks))
+        mAnimatedChunks.unite(tileChunks);
+}
+
+void TileLayerItem::indexAnimatedTiles(QPoint chunkCoordinates, const Chunk &chunk)
+{
+    for (int i = 0; i < CHUNK_SIZE * CHUNK_SIZE; ++i) {
+        Tile *tile = chunk.cellAtIndex(i).tile();
+        if (tile && tile->isAnimated())
+            mAnimatedTileChunks[tile].insert(chunkCoordinates);
+    }
+}
+
 QRectF TileLayerItem::boundingRect() const
 {
     return mBoundingRect;
@@ -68,7 +270,164 @@ void TileLayerItem::paint(QPainter *painter,
                           const QStyleOptionGraphicsItem *option,
                           QWidget *)
 {
-    MapRenderer *renderer = mMapDocument->renderer();
     // TODO: Display a border around the layer when selected
+    if (drawCachedChunks(painter, option->exposedRect))
+        return;
+
+    MapRenderer *renderer = mMapDocument->renderer();
     renderer->drawTileLayer(painter, tileLayer(), option->exposedRect);
 }
+
+/**
+ * Returns whether all tiles of this layer fit within their grid cell, in
+ * which case chunks can be drawn independently of each other.
+ */
+bool TileLayerItem::tilesFitGrid() const
+{
+    const Map *map = mMapDocument->map();
+
+    for (const SharedTileset &tileset : tileLayer()->usedTilesets()) {
+        if (!tileset->tileOffset().isNull())
+            return false;
+        if (tileset->tileWidth() > map->tileWidth() || tileset->tileHeight() > map->tileHeight())
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Draws the exposed part of this layer using pre-rendered chunk images,
+ * which is a lot faster than drawing each tile for dense layers.
+ *
+ * Returns false when the cache can't be used, for example because it is
+ * disabled or because tiles would be drawn across chunk boundaries.
+ */
+bool TileLayerItem::drawCachedChunks(QPainter *painter, const QRectF &exposed)
+{
+    QCache<ChunkImageKey, QPixmap> &cache = chunkImageCache();
+    if (cache.maxCost() <= 0)
+        return false;
+
+    const Map *map = mMapDocument->map();
+    if (map->orientation() != Map::Orthogonal)
+        return false;
+
+    const QTransform transform = painter->transform();
+    if (transform.type() > QTransform::TxScale || transform.m11() <= 0 ||
+            !qFuzzyCompare(transform.m11(), transform.m22()))
+        return false;
+
+    const TileLayer *layer = tileLayer();
+    if (!tilesFitGrid())
+        return false;
+
+    const int chunkWidth = CHUNK_SIZE * map->tileWidth();
+    const int chunkHeight = CHUNK_SIZE * map->tileHeight();
+    if (chunkWidth <= 0 || chunkHeight <= 0)
+        return false;
+
+    const qreal scale = transform.m11() * painter->device()->devicePixelRatio();
+    const int imageWidth = qCeil(chunkWidth * scale);
+    const int imageHeight = qCeil(chunkHeight * scale);
+    const int imageCost = qMax(1, imageWidth * imageHeight / 256);     // 4 bytes per pixel
+
+    if (imageWidth > MaxChunkImageSize || imageHeight > MaxChunkImageSize)
+        return false;
+    if (imageCost > cache.maxCost() / 8)
+        return false;
+
+    // Chunks with animated tiles are drawn directly, since they change often
+    updateAnimatedTiles();
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QPointF layerPos(layer->x() * map->tileWidth(),
+                           layer->y() * map->tileHeight());
+    const QRectF rect = exposed.isNull() ? mBoundingRect : exposed;
+    const QRectF layerRect = rect.translated(-layerPos);
+    const QRect bounds = layer->bounds().translated(-layer->position());
+
+    auto chunkCoordinate = [] (int v) {
+        return v < 0 ? (v + 1) / CHUNK_SIZE - 1 : v / CHUNK_SIZE;
+    };
+
+    const int startX = qMax(qFloor(layerRect.left() / chunkWidth), chunkCoordinate(bounds.left()));
+    const int startY = qMax(qFloor(layerRect.top() / chunkHeight), chunkCoordinate(bounds.top()));
+    const int endX = qMin(qFloor(layerRect.right() / chunkWidth), chunkCoordinate(bounds.right()));
+    const int endY = qMin(qFloor(layerRect.bottom() / chunkHeight), chunkCoordinate(bounds.bottom()));
+
+    const int scaleKey = qRound(scale * 1000);
+    const auto &chunks = layer->chunks();
+
+    for (int y = startY; y <= endY; ++y) {
+        for (int x = startX; x <= endX; ++x) {
+            const QPoint chunk(x, y);
+            if (!chunks.contains(chunk))
+                continue;
+
+            const QRectF chunkRect(layerPos.x() + x * chunkWidth,
+                                   layerPos.y() + y * chunkHeight,
+                                   chunkWidth, chunkHeight);
+
+            // Exclude the right and bottom edges, which belong to the next chunk
+            const QRectF chunkExposed = chunkRect.adjusted(0, 0, -1, -1);
+
+            if (mAnimatedChunks.contains(chunk)) {
+                painter->save();
+                painter->setClipRect(chunkRect, Qt::IntersectClip);
+                renderer->drawTileLayer(painter, layer, chunkExposed);
+                painter->restore();
+                continue;
+            }
+
+            const ChunkImageKey key { this, chunk, scaleKey };
+            QPixmap *image = cache.object(key);
+
+            if (!image) {
+                image = new QPixmap(imageWidth, imageHeight);
+                image->fill(Qt::transparent);
+
+                QPainter imagePainter(image);
+                imagePainter.scale(imageWidth / qreal(chunkWidth),
+                                   imageHeight / qreal(chunkHeight));
+                imagePainter.translate(-chunkRect.topLeft());
+                renderer->drawTileLayer(&imagePainter, layer, chunkExposed);
+                imagePainter.end();
+
+                painter->drawPixmap(chunkRect, *image, QRectF(image->rect()));
+
+                mCachedScales.insert(scaleKey);
+                cache.insert(key, image, imageCost);
+                continue;
+            }
+
+            painter->drawPixmap(chunkRect, *image, QRectF(image->rect()));
+        }
+    }
+
+    return true;
+}
+
+void TileLayerItem::removeCachedChunks(const QSet<QPoint> &chunks)
+{
+    QCache<ChunkImageKey, QPixmap> &cache = chunkImageCache();
+
+    for (int scale : qAsConst(mCachedScales))
+        for (const QPoint &chunk : chunks)
+            cache.remove(ChunkImageKey { this, chunk, scale });
+}
+
+void TileLayerItem::removeCachedChunks()
+{
+    if (mCachedScales.isEmpty())
+        return;
+
+    QCache<ChunkImageKey, QPixmap> &cache = chunkImageCache();
+
+    const auto keys = cache.keys();
+    for (const ChunkImageKey &key : keys)
+        if (key.item == this)
+            cache.remove(key);
+
+    mCachedScales.clear();
+}
@@ -24,6 +24,9 @@
 
 #include "tilelayer.h"
 
+#include <QHash>
+#include <QSet>
+
 namespace Tiled {
 namespace Internal {
 
@@ -42,6 +45,7 @@ public:
      * @param mapDocument the map document owning the map of this layer
      */
     TileLayerItem(TileLayer *layer, MapDocument *mapDocument, QGraphicsItem *parent = nullptr);
+    ~TileLayerItem() override;
 
     TileLayer *tileLayer() const;
 
@@ -55,6 +59,11 @@ public:
      */
     void syncWithTileLayer();
 
+    void invalidateChunks();
+    void invalidateChunks(const QRegion &region);
+
+    void repaintTiles(const QSet<Tile*> &tiles);
+
     // QGraphicsItem
     QRectF boundingRect() const override;
     void paint(QPainter *painter,
@@ -62,8 +71,31 @@ public:
                QWidget *widget = nullptr) override;
 
 private:
+    void updateAnimatedTiles();
+    void indexAnimatedTiles(QPoint chunkCoordinates, const Chunk &chunk);
+
+    bool tilesFitGrid() const;
+    bool drawCachedChunks(QPainter *painter, const QRectF &exposed);
+    void removeCachedChunks(const QSet<QPoint> &chunks);
+    void removeCachedChunks();
+
     MapDocument *mMapDocument;
     QRectF mBoundingRect;
+
+    /**
+     * For each animated tile, the coordinates of the chunks that use it.
+     * Allows repainting only the chunks showing a tile animation that
+     * advanced, rather than the entire layer.
+     */
+    QHash<Tile*, QSet<QPoint>> mAnimatedTileChunks;
+    QSet<QPoint> mAnimatedChunks;
+    QSet<QPoint> mDirtyChunks;
+    bool mAnimatedTilesDirty;
+
+    /**
+     * The scales at which chunk images of this layer have been cached.
+     */
+    QSet<int> mCachedScales;
 };
 
 inline TileLayer *TileLayerItem::tileLayer() const
@@ -26,6 +26,9 @@
 
 #include <QQueue>
 
+#include <algorithm>
+#include <climits>
+
 using namespace Tiled;
 using namespace Tiled::Internal;
 
@@ -120,6 +123,29 @@ void TilePainter::setCells(int x, int y,
     emit mMapDocument->regionChanged(region, mTileLayer);
 }
 
+void TilePainter::copyCells(const TileLayer *tileLayer, const QRegion &region)
+{
+    const QRegion paintable = paintableRegion(region);
+    if (paintable.isEmpty())
+        return;
+
+    TileLayerChangeWatcher watcher(mMapDocument, mTileLayer);
+
+    const QRegion area = paintable.translated(-mTileLayer->position());
+#if QT_VERSION < 0x050800
+    const auto rects = area.rects();
+    for (const QRect &rect : rects) {
+#else
+    for (const QRect &rect : area) {
+#endif
+        for (int _y = rect.top(); _y <= rect.bottom(); ++_y)
+            for (int _x = rect.left(); _x <= rect.right(); ++_x)
+                mTileLayer->setCell(_x, _y, tileLayer->cellAt(_x, _y));
+    }
+
+    emit mMapDocument->regionChanged(paintable, mTileLayer);
+}
+
 void TilePainter::drawCells(int x, int y, TileLayer *tileLayer)
 {
     const QRegion region = paintableRegion(x, y,
@@ -203,6 +229,101 @@ void TilePainter::erase(const QRegion &region)
     emit mMapDocument->regionChanged(paintable, mTileLayer);
 }
 
+namespace {
+
+/**
+ * Reads the cells along a single row of a tile layer. The chunk is only
+ * looked up when crossing into the next one, rather than for each cell.
+ */
+class RowReader
+{
+public:
+    RowReader(const TileLayer *layer, int y)
+        : mLayer(layer)
+        , mY(y)
+        , mChunkX(INT_MIN)
+        , mChunk(nullptr)
+    {}
+
+    Cell cellAt(int x)
+    {
+        const int chunkX = x < 0 ? (x + 1) / CHUNK_SIZE - 1 : x / CHUNK_SIZE;
+        if (chunkX != mChunkX) {
+            mChunkX = chunkX;
+            mChunk = mLayer->findChunk(x, mY);
+        }
+
+        if (mChunk)
+            return mChunk->cellAt(x & CHUNK_MASK, mY & CHUNK_MASK);
+        return Cell();
+    }
+
+private:
+    const TileLayer *mLayer;
+    const int mY;
+    int mChunkX;
+    const Chunk *mChunk;
+};
+
+} // anonymous namespace
+
+/**
+ * Builds a region from the given single-row \a spans in one go, which is a
+ * lot faster than uniting them one by one.
+ *
+ * Overlapping spans are merged and consecutive rows with the same spans are
+ * combined into a single band, as required by QRegion::setRects.
+ */
+static QRegion regionFromSpans(QVector<QRect> &spans)
+{
+    std::sort(spans.begin(), spans.end(), [] (const QRect &a, const QRect &b) {
+        return a.top() < b.top() || (a.top() == b.top() && a.left() < b.left());
+    });
+
+    QVector<QRect> rects;
+    rects.reserve(spans.size());
+
+    int bandStart = 0;      // index in rects where the last band starts
+    int rowStart = 0;       // index in rects where the current row starts
+
+    for (int i = 0; i < spans.size(); ) {
+        const int y = spans.at(i).top();
+        rowStart = rects.size();
+
+        // Merge the spans on this row where they touch or overlap
+        for (; i < spans.size() && spans.at(i).top() == y; ++i) {
+            const QRect &span = spans.at(i);
+            if (rects.size() > rowStart && rects.last().right() + 1 >= span.left())
+                rects.last().setRight(qMax(rects.last().right(), span.right()));
+            else
+                rects.append(span);
+        }
+
+        // Extend the previous band when this row has the same spans
+        const int bandRows = rowStart - bandStart;
+        bool sameSpans = bandRows == rects.size() - rowStart &&
+                rowStart > 0 && rects.at(bandStart).bottom() + 1 == y;
+
+        for (int j = 0; sameSpans && j < bandRows; ++j) {
+            const QRect &a = rects.at(bandStart + j);
+            const QRect &b = rects.at(rowStart + j);
+            sameSpans = a.left() == b.left() && a.right() == b.right();
+        }
+
+        if (sameSpans) {
+            for (int j = bandStart; j < rowStart; ++j)
+                rects[j].setBottom(y);
+            rects.resize(rowStart);
+        } else {
+            bandStart = rowStart;
+        }
+    }
+
+    QRegion region;
+    region.setRects(rects.constData(), rects.size());
+    return region;
+}
+
 static QRegion fillRegion(const TileLayer *layer,
                           const QRegion &region,
                           QPoint fillOrigin,
@@ -232,7 +353,7 @@ static QRegion fillRegion(const TileLayer *layer,
     // This is faster than checking if a given cell is in the region/list
     QVector<bool> processedCellsVec(width * height);
     bool *processedCells = processedCellsVec.data();
-    QRegion fillRegion;
+    QVector<QRect> spans;
 
     // Loop through queued positions and fill them, while at the same time
     // checking adjacent positions to see if they should be added
@@ -240,22 +361,24 @@ static QRegion fillRegion(const TileLayer *layer,
         const QPoint currentPoint = fillPositions.dequeue();
         const int startOfLine = currentPoint.y() * width;
 
+        RowReader row(layer, currentPoint.y());
+
         // Seek as far left as we can
         int left = currentPoint.x();
-        while (left > bounds.left() && layer->cellAt(left - 1, currentPoint.y()) == matchCell) {
+        while (left > bounds.left() && row.cellAt(left - 1) == matchCell) {
             --left;
             processedCells[indexOffset + startOfLine + left] = true;
         }
 
         // Seek as far right as we can
         int right = currentPoint.x();
-        while (right < bounds.right() && layer->cellAt(right + 1, currentPoint.y()) == matchCell) {
+        while (right < bounds.right() && row.cellAt(right + 1) == matchCell) {
             ++right;
             processedCells[indexOffset + startOfLine + right] = true;
         }
 
-        // Add cells between left and right to the region
-        fillRegion += QRegion(left, currentPoint.y(), right - left + 1, 1);
+        // Remember the cells between left and right, the region is built at the end
+        spans.append(QRect(left, currentPoint.y(), right - left + 1, 1));
 
         bool leftColumnIsStaggered = false;
         bool rightColumnIsStaggered = false;
@@ -278,11 +401,12 @@ static QRegion fillRegion(const TileLayer *layer,
         // to be added to the queue.
         auto findFillPositions = [=,&fillPositions](int left, int right, int y) {
             bool adjacentCellAdded = false;
+            RowReader adjacentRow(layer, y);
 
             for (int x = left; x <= right; ++x) {
                 const int index = y * width + x;
 
-                if (!processedCells[indexOffset + index] && layer->cellAt(x, y) == matchCell) {
+                if (!processedCells[indexOffset + index] && adjacentRow.cellAt(x) == matchCell) {
                     // Do not add the cell to the queue if an adjacent cell was added.
                     if (!adjacentCellAdded) {
                         fillPositions.enqueue(QPoint(x, y));
@@ -325,7 +449,7 @@ static QRegion fillRegion(const TileLayer *layer,
         }
     }
 
-    return fillRegion;
+    return regionFromSpans(spans);
 }
 
 QRegion TilePainter::computePaintableFillRegion(const QPoint &fillOrigin) const
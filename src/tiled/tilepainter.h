@@ -72,6 +72,13 @@ public:
      */
     void setCells(int x, int y, TileLayer *tileLayer, const QRegion &mask);
 
+    /**
+     * Sets the cells within \a region to the cells at the same location in
+     * the given tile layer, which uses the coordinates of the edited layer.
+     * The \a region is given in map coordinates.
+     */
+    void copyCells(const TileLayer *tileLayer, const QRegion &region);
+
     /**
      * Draws the cells in the given tile layer at the given coordinates. The
      * coordinates \a x and \a y are relative to the map origin.
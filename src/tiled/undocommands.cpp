@@ -41,5 +41,36 @@ bool cloneChildren(const QUndoCommand *command, QUndoCommand *parent)
     return true;
 }
 
+/**
+ * Returns the memory used by the given \a command and its children, as far
+ * as they implement CollapsibleUndoCommand.
+ */
+qint64 undoMemoryUsage(const QUndoCommand *command)
+{
+    qint64 usage = 0;
+
+    if (auto collapsible = dynamic_cast<const CollapsibleUndoCommand*>(command))
+        usage += collapsible->memoryUsage();
+
+    for (int i = 0, count = command->childCount(); i < count; ++i)
+        usage += undoMemoryUsage(command->child(i));
+
+    return usage;
+}
+
+/**
+ * Collapses the given \a command and its children, as far as they implement
+ * CollapsibleUndoCommand.
+ */
+void collapseUndoCommand(QUndoCommand *command)
+{
+    if (auto collapsible = dynamic_cast<CollapsibleUndoCommand*>(command))
+        collapsible->collapse();
+
+    // QUndoCommand only provides const access to its children
+    for (int i = 0, count = command->childCount(); i < count; ++i)
+        collapseUndoCommand(const_cast<QUndoCommand*>(command->child(i)));
+}
+
 } // namespace Internal
 } // namespace Tiled
@@ -20,6 +20,8 @@
 
 #pragma once
 
+#include <QtGlobal>
+
 class QUndoCommand;
 
 namespace Tiled {
@@ -55,5 +57,28 @@ public:
 
 bool cloneChildren(const QUndoCommand *command, QUndoCommand *parent);
 
+/**
+ * Interface to be implemented by undo commands that may hold on to a lot of
+ * memory, to allow limiting the memory used by the undo history.
+ *
+ * A collapsed command releases its data. Undoing or redoing it no longer has
+ * any effect, so it should no longer be reachable from the current state.
+ */
+class CollapsibleUndoCommand
+{
+public:
+    virtual ~CollapsibleUndoCommand() = default;
+
+    /**
+     * Returns an estimate of the memory used by this command, in bytes.
+     */
+    virtual qint64 memoryUsage() const = 0;
+
+    virtual void collapse() = 0;
+};
+
+qint64 undoMemoryUsage(const QUndoCommand *command);
+void collapseUndoCommand(QUndoCommand *command);
+
 } // namespace Internal
 } // namespace Tiled
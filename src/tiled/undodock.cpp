@@ -21,19 +21,87 @@
 
 #include "undodock.h"
 
+#include "document.h"
+
 #include <QEvent>
+#include <QMouseEvent>
+#include <QPointer>
 #include <QUndoView>
 #include <QVBoxLayout>
 
 using namespace Tiled;
 using namespace Tiled::Internal;
 
+namespace Tiled {
+namespace Internal {
+
+/**
+ * An undo view that doesn't allow going back beyond the undo floor of the
+ * document, since the commands below it were collapsed.
+ *
+ * Row 0 is the initial state, and row n the state after the nth command.
+ */
+class UndoView : public QUndoView
+{
+public:
+    UndoView(QWidget *parent)
+        : QUndoView(parent)
+    {}
+
+    void setDocument(Document *document)
+    {
+        mDocument = document;
+        setStack(document ? document->undoStack() : nullptr);
+    }
+
+protected:
+    void mousePressEvent(QMouseEvent *event) override
+    {
+        if (isBelowFloor(indexAt(event->pos())))
+            return;
+        QUndoView::mousePressEvent(event);
+    }
+
+    void mouseMoveEvent(QMouseEvent *event) override
+    {
+        if (isBelowFloor(indexAt(event->pos())))
+            return;
+        QUndoView::mouseMoveEvent(event);
+    }
+
+    QModelIndex moveCursor(CursorAction cursorAction,
+                           Qt::KeyboardModifiers modifiers) override
+    {
+        const QModelIndex index = QUndoView::moveCursor(cursorAction, modifiers);
+        if (isBelowFloor(index))
+            return model()->index(mDocument->undoFloor(), 0);
+        return index;
+    }
+
+    void keyboardSearch(const QString &search) override
+    {
+        if (!mDocument || mDocument->undoFloor() == 0)
+            QUndoView::keyboardSearch(search);
+    }
+
+private:
+    bool isBelowFloor(const QModelIndex &index) const
+    {
+        return mDocument && index.isValid() && index.row() < mDocument->undoFloor();
+    }
+
+    QPointer<Document> mDocument;
+};
+
+} // namespace Internal
+} // namespace Tiled
+
 UndoDock::UndoDock(QWidget *parent)
     : QDockWidget(parent)
 {
     setObjectName(QLatin1String("undoViewDock"));
 
-    mUndoView = new QUndoView(this);
+    mUndoView = new UndoView(this);
     QIcon cleanIcon(QLatin1String(":images/16x16/drive-harddisk.png"));
     mUndoView->setCleanIcon(cleanIcon);
     mUndoView->setUniformItemSizes(true);
@@ -47,9 +115,9 @@ UndoDock::UndoDock(QWidget *parent)
     retranslateUi();
 }
 
-void UndoDock::setStack(QUndoStack *stack)
+void UndoDock::setDocument(Document *document)
 {
-    mUndoView->setStack(stack);
+    mUndoView->setDocument(document);
 }
 
 void UndoDock::changeEvent(QEvent *e)
@@ -23,12 +23,12 @@
 
 #include <QDockWidget>
 
-class QUndoStack;
-class QUndoView;
-
 namespace Tiled {
 namespace Internal {
 
+class Document;
+class UndoView;
+
 /**
  * A dock widget showing the undo stack. Mainly for debugging, but can also be
  * useful for the user.
@@ -40,14 +40,14 @@ class UndoDock : public QDockWidget
 public:
     UndoDock(QWidget *parent = nullptr);
 
-    void setStack(QUndoStack *stack);
+    void setDocument(Document *document);
 
 protected:
     void changeEvent(QEvent *e) override;
 
 private:
     void retranslateUi();
-    QUndoView *mUndoView;
+    UndoView *mUndoView;
 };
 
 } // namespace Internal
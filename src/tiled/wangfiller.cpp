@@ -250,10 +250,10 @@ TileLayer *WangFiller::fillRegion(const TileLayer &back,
     return tileLayer;
 }
 
-const Cell &WangFiller::getCell(const TileLayer &back,
-                                const TileLayer &front,
-                                const QRegion &fillRegion,
-                                QPoint point) const
+Cell WangFiller::getCell(const TileLayer &back,
+                         const TileLayer &front,
+                         const QRegion &fillRegion,
+                         QPoint point) const
 {
     if (!fillRegion.contains(point))
         return back.cellAt(point);
@@ -72,10 +72,10 @@ private:
     //gets a cell from either the back or front, based on
     //the fill region. Point, front, and fillRegion
     //are relative to back.
-    const Cell &getCell(const TileLayer &back,
-                        const TileLayer &front,
-                        const QRegion &fillRegion,
-                        QPoint point) const;
+    Cell getCell(const TileLayer &back,
+                 const TileLayer &front,
+                 const QRegion &fillRegion,
+                 QPoint point) const;
 
     //gets a wangId based on front and back.
     //adjacent cells are gotten from getCell()
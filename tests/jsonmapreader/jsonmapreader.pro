@@ -0,0 +1,12 @@
+QT += testlib
+CONFIG += c++11
+TEMPLATE = app
+
+JSON_PLUGIN = ../../src/plugins/json
+
+INCLUDEPATH += $$JSON_PLUGIN $$JSON_PLUGIN/qjsonparser
+
+# Input
+SOURCES += test_jsonmapreader.cpp \
+    $$JSON_PLUGIN/jsonmapreader.cpp \
+    $$JSON_PLUGIN/qjsonparser/json.cpp
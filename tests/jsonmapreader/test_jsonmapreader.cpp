@@ -0,0 +1,51 @@
+#include "jsonmapreader.h"
+#include "json.h"
+
+#include <QtTest/QtTest>
+
+using namespace Json;
+
+class test_JsonMapReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTripStrings_data();
+    void roundTripStrings();
+};
+
+void test_JsonMapReader::roundTripStrings_data()
+{
+    QTest::addColumn<QString>("string");
+
+    QTest::newRow("plain") << QStringLiteral("Some object");
+    QTest::newRow("quote") << QStringLiteral("say \"hello\"");
+    QTest::newRow("backslash") << QStringLiteral("C:\\maps\\new");
+    QTest::newRow("slash") << QStringLiteral("../tilesets/tiles.tsx");
+    QTest::newRow("control") << QStringLiteral("line\nbreak\tand\rreturn");
+    QTest::newRow("trailing backslash") << QStringLiteral("end\\");
+    QTest::newRow("unicode") << QString::fromUtf8("caf\xc3\xa9 \xe2\x82\xac");
+}
+
+void test_JsonMapReader::roundTripStrings()
+{
+    QFETCH(QString, string);
+
+    QVariantMap object;
+    object.insert(QStringLiteral("name"), string);
+    object.insert(string, 1);
+
+    JsonWriter writer;
+    QVERIFY(writer.stringify(object));
+
+    JsonMapReader reader;
+    QVERIFY2(reader.parse(writer.result().toUtf8()),
+             qPrintable(reader.errorString()));
+
+    const QVariantMap result = reader.result().toMap();
+    QCOMPARE(result.value(QStringLiteral("name")).toString(), string);
+    QVERIFY(result.contains(string));
+}
+
+QTEST_MAIN(test_JsonMapReader)
+#include "test_jsonmapreader.moc"
@@ -1,4 +1,6 @@
 TEMPLATE=subdirs
 SUBDIRS = \
+    jsonmapreader \
     mapreader \
-    staggeredrenderer
+    staggeredrenderer \
+    tilelayer
@@ -0,0 +1,43 @@
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_TileLayer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void replaceAndRemoveTileset();
+};
+
+void test_TileLayer::replaceAndRemoveTileset()
+{
+    SharedTileset tilesetA = Tileset::create(QLatin1String("A"), 32, 32);
+    SharedTileset tilesetB = Tileset::create(QLatin1String("B"), 32, 32);
+    Tile *tileA = tilesetA->findOrCreateTile(0);
+    Tile *tileB = tilesetB->findOrCreateTile(1);
+
+    // Both tilesets are used within the same chunk
+    TileLayer layer(QLatin1String("Layer"), 0, 0, 4, 4);
+    layer.setCell(0, 0, Cell(tileA));
+    layer.setCell(1, 0, Cell(tileB));
+
+    layer.replaceReferencesToTileset(tilesetA.data(), tilesetB.data());
+
+    QCOMPARE(layer.cellAt(0, 0).tileset(), tilesetB.data());
+    QCOMPARE(layer.cellAt(0, 0).tileId(), 0);
+    QCOMPARE(layer.cellAt(1, 0).tileset(), tilesetB.data());
+    QCOMPARE(layer.cellAt(1, 0).tileId(), 1);
+
+    layer.removeReferencesToTileset(tilesetB.data());
+
+    QVERIFY(layer.cellAt(0, 0).isEmpty());
+    QVERIFY(layer.cellAt(1, 0).isEmpty());
+    QVERIFY(layer.isEmpty());
+}
+
+QTEST_MAIN(test_TileLayer)
+#include "test_tilelayer.moc"